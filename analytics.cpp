@@ -0,0 +1,210 @@
+#include "analytics.h"
+#include "filelock.h"
+#include "foodids.h"
+#include "logstore.h"
+#include "profilestore.h"
+#include "reports.h"
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+static const size_t analyticsBatchUsers = 4096;   // users read from users.txt at a time
+static const int adherenceBuckets = 10;           // 0-10%, ..., 90-100%
+static const int topFoods = 10;
+
+struct AnalyticsUser {
+    string username;
+    uint32_t id = NO_USER_ID;
+};
+
+// One worker's partial aggregate (and the merged result).
+struct PopulationStats {
+    uint64_t users = 0;
+    uint64_t activeUsers = 0;           // users with entries in the window
+    uint64_t loggedDays = 0;
+    double intakeSum = 0.0;             // sum over active users of their average intake
+    double targetSum = 0.0;
+    double ratioSum = 0.0;              // sum of intake / target
+    uint64_t adherence[adherenceBuckets] = {};
+    uint64_t entries = 0;
+    uint64_t customEntries = 0;
+    unordered_map<uint32_t, uint64_t> foodCounts;   // shared food ID -> entries
+};
+
+static void mergeStats(PopulationStats& into, const PopulationStats& from) {
+    into.users += from.users;
+    into.activeUsers += from.activeUsers;
+    into.loggedDays += from.loggedDays;
+    into.intakeSum += from.intakeSum;
+    into.targetSum += from.targetSum;
+    into.ratioSum += from.ratioSum;
+    for (int b = 0; b < adherenceBuckets; ++b) into.adherence[b] += from.adherence[b];
+    into.entries += from.entries;
+    into.customEntries += from.customEntries;
+    for (const auto& food : from.foodCounts) into.foodCounts[food.first] += food.second;
+}
+
+// Scratch buffers a worker reuses for every user.
+struct ScanBuffers {
+    vector<LogSegment> segments;
+    vector<LogRecord> records;
+    vector<DayTotals> days;
+};
+
+// Adds one user's window to the partial aggregate.
+static void scanUser(const AnalyticsUser& user, int firstDay, int lastDay, PopulationStats& stats, ScanBuffers& buf) {
+    stats.users++;
+    ProfileRecord profile;
+    if (user.id == NO_USER_ID || !readProfileRecord(user.id, profile)) return;
+    // Held so the segments match the manifest their checksums are read from
+    FileLock lock(userLockFile(user.username), LOCK_MODE_SHARED);
+    if (!readLogManifest(user.username, buf.segments)) return;
+
+    buf.days.assign(lastDay - firstDay + 1, DayTotals());
+    for (const LogSegment& seg : buf.segments) {
+        if (seg.lastDay < firstDay || seg.firstDay > lastDay) continue;
+        buf.records.clear();
+        LogReader reader;
+        if (!openLogReader(reader, logSegmentFileName(user.username, seg.month), &seg)) continue;
+        LogRecord r;
+        while (readLogRecord(reader, r)) buf.records.push_back(r);
+        if (!seg.sealed) foldLogCorrections(buf.records);
+
+        for (const LogRecord& rec : buf.records) {
+            if (rec.day < firstDay || rec.day > lastDay) continue;
+            sumLogRecords(&rec, 1, buf.days[rec.day - firstDay]);
+            stats.entries++;
+            if (rec.foodId & CUSTOM_FOOD_ID_BIT) stats.customEntries++;
+            else if (rec.foodId != 0) stats.foodCounts[rec.foodId]++;
+        }
+    }
+
+    double target = profile.calorieTarget;
+    int logged = 0, withinTarget = 0;
+    double calories = 0.0;
+    for (const DayTotals& t : buf.days) {
+        if (t.entries <= 0) continue;
+        double dayCalories = fromFixed(t.calories);
+        logged++;
+        calories += dayCalories;
+        if (target > 0 && fabs(dayCalories - target) <= target * REPORT_TARGET_TOLERANCE) withinTarget++;
+    }
+    if (logged == 0) return;
+
+    double average = calories / logged;
+    stats.activeUsers++;
+    stats.loggedDays += logged;
+    stats.intakeSum += average;
+    stats.targetSum += target;
+    stats.ratioSum += target > 0 ? average / target : 0.0;
+    stats.adherence[min(withinTarget * adherenceBuckets / logged, adherenceBuckets - 1)]++;
+}
+
+// Scans one batch: each worker claims the next user until none are left.
+static void scanBatch(const vector<AnalyticsUser>& batch, int firstDay, int lastDay,
+                      vector<PopulationStats>& partials, vector<ScanBuffers>& buffers) {
+    atomic<size_t> nextUser(0);
+    auto worker = [&](size_t slot) {
+        for (size_t i = nextUser++; i < batch.size(); i = nextUser++) {
+            scanUser(batch[i], firstDay, lastDay, partials[slot], buffers[slot]);
+        }
+    };
+    size_t threads = min(partials.size(), batch.size());
+    if (threads <= 1) {
+        worker(0);
+        return;
+    }
+    vector<thread> pool;
+    for (size_t t = 0; t < threads; ++t) pool.push_back(thread(worker, t));
+    for (thread& t : pool) t.join();
+}
+
+static void printReport(ostream& out, const PopulationStats& s, int firstDay, int lastDay) {
+    out << "POPULATION REPORT " << dayNumberToDate(firstDay) << " to " << dayNumberToDate(lastDay) << "\n\n";
+    out << left << setw(24) << "Users:" << s.users << " (" << s.activeUsers << " with entries)\n";
+    if (s.activeUsers == 0) return;
+
+    double active = (double)s.activeUsers;
+    out << fixed << setprecision(0);
+    out << left << setw(24) << "Average intake:" << s.intakeSum / active << " kcal per logged day\n";
+    out << left << setw(24) << "Average target:" << s.targetSum / active << " kcal\n";
+    out << left << setw(24) << "Intake vs target:" << showpos << (s.ratioSum / active - 1.0) * 100.0 << noshowpos << "%\n";
+    out << setprecision(1);
+    out << left << setw(24) << "Logged days per user:" << s.loggedDays / active << "\n\n";
+
+    out << "Adherence (share of a user's logged days within " << (int)(REPORT_TARGET_TOLERANCE * 100)
+        << "% of the calorie target):\n";
+    uint64_t largest = *max_element(s.adherence, s.adherence + adherenceBuckets);
+    for (int b = 0; b < adherenceBuckets; ++b) {
+        string label = to_string(b * 10) + "-" + to_string(b * 10 + 10) + "%";
+        int bar = largest > 0 ? (int)(s.adherence[b] * 40 / largest) : 0;
+        out << "  " << left << setw(9) << label << setw(41) << string(bar, '#') << s.adherence[b] << "\n";
+    }
+
+    vector<pair<uint64_t, uint32_t>> foods;
+    for (const auto& food : s.foodCounts) foods.push_back({ food.second, food.first });
+    size_t shown = min(foods.size(), (size_t)topFoods);
+    partial_sort(foods.begin(), foods.begin() + shown, foods.end(),
+                 [](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b) {
+                     return a.first != b.first ? a.first > b.first : a.second < b.second;
+                 });
+    out << "\nMost-logged foods:\n";
+    for (size_t i = 0; i < shown; ++i) {
+        FoodItem food;
+        FoodRef ref;
+        ref.id = foods[i].second;
+        string name = resolveFood("", ref, food) ? string(food.name()) : "Food #" + to_string(ref.id);
+        out << "  " << right << setw(2) << i + 1 << ". " << left << setw(30) << name << foods[i].first << " entries\n";
+    }
+    if (s.entries > 0) {
+        out << "  Custom foods: " << s.customEntries * 100.0 / s.entries << "% of " << s.entries << " entries\n";
+    }
+    out.unsetf(ios::fixed);
+    out << setprecision(6);
+}
+
+void runPopulationReport(ostream& out, int days) {
+    auto start = chrono::steady_clock::now();
+    int lastDay = dateToDayNumber(getTodayDate());
+    int firstDay = lastDay - max(days, 1) + 1;
+
+    size_t threads = max(1u, thread::hardware_concurrency());
+    vector<PopulationStats> partials(threads);
+    vector<ScanBuffers> buffers(threads);
+
+    // IDs are looked up (and old profiles imported) on this thread between
+    // batches; the workers only read
+    ifstream users("users.txt");
+    vector<AnalyticsUser> batch;
+    string line;
+    bool more = true;
+    while (more) {
+        batch.clear();
+        while (batch.size() < analyticsBatchUsers && (more = (bool)getline(users, line))) {
+            AnalyticsUser user;
+            user.username = trim(line.substr(0, line.find('|')));
+            if (user.username.empty()) continue;
+            user.id = findUserId(user.username);
+            batch.push_back(user);
+        }
+        if (!batch.empty()) scanBatch(batch, firstDay, lastDay, partials, buffers);
+    }
+
+    PopulationStats total;
+    for (const PopulationStats& partial : partials) mergeStats(total, partial);
+    printReport(out, total, firstDay, lastDay);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    out << "\nScanned " << total.users << " user(s) on " << threads << " thread(s) in " << fixed
+        << setprecision(3) << seconds * 1000.0 << " ms.\n";
+    out.unsetf(ios::fixed);
+}
@@ -0,0 +1,26 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <iostream>
+
+// Population analytics over every registered user: average intake against
+// the calorie target, the distribution of adherence (share of logged days
+// within REPORT_TARGET_TOLERANCE of the target, reports.h), and the most
+// logged shared foods.
+//
+// Users are read from users.txt in fixed-size batches. A pool of worker
+// threads scans each batch: every worker takes the next unscanned user (so a
+// long history does not hold the others up), reads the user's log segments
+// that overlap the window with the ordinary segment reader, and adds the
+// results to its own partial aggregate. The partials are merged into the
+// report at the end. Memory depends on the batch size, one month segment per
+// worker and the number of shared foods, not on the number of users.
+//
+// Users whose log has not been migrated to segments yet (no manifest) count
+// as having no entries until their next login.
+
+// "--population-report [days]": scans the last days (default 30, today
+// included) and prints the report.
+void runPopulationReport(std::ostream& out, int days);
+
+#endif
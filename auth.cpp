@@ -2,6 +2,8 @@
 #include "profile.h"
 #include "utils.h"
 #include "models.h"
+#include "profilestore.h"
+#include "userdirs.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -38,6 +40,12 @@ bool getValidUsername(string &username, char choice)
             continue;
         }
         
+        if (username.size() >= PROFILE_USERNAME_BYTES)
+        {
+            cout << "\nUsername is too long! Use at most " << PROFILE_USERNAME_BYTES - 1 << " characters.\n";
+            continue;
+        }
+
         if (!isalpha(username[0]))  
         {
             cout << "\nInvalid username! Username must start with a letter. Try again.\n";
@@ -234,8 +242,8 @@ bool getValidFullname(string &fullname)
         }
 
         
-        if (fullname.size() > 255) {
-            cout << "Name is too long. Please enter a shorter name (max 1024 chars).\n";
+        if (fullname.size() >= PROFILE_NAME_BYTES) {
+            cout << "Name is too long. Please enter a shorter name (max " << PROFILE_NAME_BYTES - 1 << " bytes).\n";
             continue;
         }
 
@@ -337,8 +345,9 @@ bool isProportional(int age, double height, double weight) {
     return true;
 }
 
-bool getValidGender(string &gender) 
+bool getValidGender(Gender &genderOut) 
 {
+    string gender;
     while (true) 
 	{
         cout << "\n\nEnter Gender (M/F) (or 'b' to back): ";
@@ -364,12 +373,12 @@ bool getValidGender(string &gender)
 
         if (gender == "m" || gender == "male") 
 		{
-            gender = "Male";  
+            genderOut = GENDER_MALE;  
             break;
         } 
 		else if (gender == "f" || gender == "female") 
 		{
-            gender = "Female"; 
+            genderOut = GENDER_FEMALE; 
             break;
         } 
 		else 
@@ -447,15 +456,8 @@ bool getValidWeight( double &weight) {
     return true;
 }
 
-bool getValidActivityLevel(string &activityLevel)
+bool getValidActivityLevel(ActivityLevel &activityLevel)
 {
-    const string allActivityLevels[] = {
-        "Sedentary",
-        "Lightly Active",
-        "Moderately Active",
-        "Very Active"
-    };
-
     string input;
     int choice;
 
@@ -491,7 +493,7 @@ bool getValidActivityLevel(string &activityLevel)
         }
 
         
-        activityLevel = allActivityLevels[choice - 1];
+        activityLevel = (ActivityLevel)(choice - 1);
         break;
     }
     return true;
@@ -500,34 +502,42 @@ bool getValidActivityLevel(string &activityLevel)
 void registerUser(char choice)
 {
     UserProfile ua;
+    string password, fullName;
+    int age = 0, height = 0;
+    double weight = 0.0;
 
     printHeader("REGISTER NEW USER");
     if (!getValidUsername(ua.username, choice)) return;
 
-    if (!getValidPassword(ua.password, ua.username, choice)) return;
+    if (!getValidPassword(password, ua.username, choice)) return;
 
-    if (!getValidFullname(ua.fullName)) return;
+    if (!getValidFullname(fullName)) return;
 
     // Loop label for re-entering age/height/weight when proportions are invalid
     start_age:
-    if (!getValidAge(ua.age)) return;
+    if (!getValidAge(age)) return;
 
     if (!getValidGender(ua.gender)) return;
 
-    if (!getValidHeight(ua.height_cm)) return;
+    if (!getValidHeight(height)) return;
 
-    if (!getValidWeight(ua.weight_kg)) return;
+    if (!getValidWeight(weight)) return;
 
     // Verify proportionality before moving to activity level
-    if (!isProportional(ua.age, static_cast<double>(ua.height_cm), ua.weight_kg)) {
+    if (!isProportional(age, static_cast<double>(height), weight)) {
         cout << "\nThe age, height and weight you entered are not proportional. Please re-enter them.\n";
         goto start_age;
     }
 
     if (!getValidActivityLevel(ua.activityLevel)) return;
 
+    ua.fullNameId = internString(fullName);
+    ua.age = (uint16_t)age;
+    ua.height_cm = (uint16_t)height;
+    ua.weight_kg = (float)weight;
     calcMacroTargets(ua);
 
+    ensureUserDir(ua.username);
     // Append mode and raw string literal for file path
     ofstream file("users.txt", ios::app);
     if (!file) {
@@ -536,19 +546,18 @@ void registerUser(char choice)
     }
 
     file << ua.username << "|"
-            << ua.password
-            << "|user_" << ua.username << "_data.txt|"
-            << ua.fullName << "|"
+            << password
+            << "|" << userFilePath(ua.username, "data.txt") << "|"
+            << fullName << "|"
             << ua.age << "|"
-            << ua.gender << "|"
+            << GENDER_NAMES[ua.gender] << "|"
             << ua.height_cm << "|"
-            << ua.weight_kg << "|"
-            <<ua.activityLevel<<"\n";
+            << weight << "|"
+            << ACTIVITY_LEVEL_NAMES[ua.activityLevel] << "\n";
     file.close();
+    password.assign(password.size(), '\0');
 
-    string filename = "user_" + ua.username + "_data.txt";
-
-        createUserDataFile(filename, ua);
+    if (!createUserProfile(ua)) return;
         cout << "\n--------------------------------------------\n"
              << "    Profile created successfully!   \n"
              << "--------------------------------------------\n\n";
@@ -561,21 +570,22 @@ bool loginUser( UserProfile& profile,char choice)
     string inputUsername, inputPassword;
 
     if (!getValidUsername(inputUsername, choice)) return false;
-    if (!getValidPassword(inputPassword, inputUsername, choice)) return false;
+    bool passwordOk = getValidPassword(inputPassword, inputUsername, choice);
+    inputPassword.assign(inputPassword.size(), '\0');   // not kept after the check
+    if (!passwordOk) return false;
 
     cout << "\n\nLogin successful! \n";
     cout << "Welcome back, 👤 " << inputUsername << "!\n\n";
     
-    string filename = "user_" + inputUsername + "_data.txt";
     profile.username = inputUsername;
-    loadProfileFromFile(filename, profile);
+    loadUserProfile(inputUsername, profile);
     cout << "👉 Press Enter to continue.....";
     cin.ignore(numeric_limits<streamsize>::max(), '\n');
     cin.get();
     clearScreen(); 
     return true;
 }                         
-bool authentication(UserProfile& profile)
+bool authentication(UserProfile& profile, bool& quit)
 {
 	firstWellcomePage();
 	char choice;
@@ -604,7 +614,8 @@ bool authentication(UserProfile& profile)
 	        case '3':
 	        {
         		cout << "\nThank you! Goodbye 👋\n";
-            	exit(0);	
+            	quit = true;
+            	return false;
 			}
 	           	
 	        default:
@@ -13,14 +13,14 @@ bool getValidUsername(string &username, char choice);
 bool getValidPassword(string &password, const string &username, char choice);
 bool getValidFullname(string &fullname);
 bool getValidAge(int &age);
-bool getValidGender(string &gender);
+bool getValidGender(Gender &gender);
 bool getValidHeight(int &height);
-bool getValidWeight(int &weight); 
-bool getValidActivityLevel(string &activityLevel);
+bool getValidWeight(double &weight); 
+bool getValidActivityLevel(ActivityLevel &activityLevel);
 
 // User flow functions
 void registerUser(char choice);
 bool loginUser(UserProfile& profile, char choice);
-bool authentication(UserProfile &profile);
+bool authentication(UserProfile &profile, bool &quit);   // quit: the user chose Exit
 
 #endif
@@ -0,0 +1,553 @@
+#include "catalog.h"
+#include "filelock.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// Shared catalog snapshot and per-user overlays.
+// The shared catalog is read-copy-update with epochs: a reader counts itself in
+// the slot of the current epoch, then loads the snapshot pointer; it never
+// waits. The watcher builds a complete replacement off to the side, swaps the
+// pointer, moves to the next epoch and frees the old snapshot once the old
+// epoch's slot drains, so in-flight searches keep the catalog they started with.
+// Overlays are loaded once per session and only touched by the session thread.
+static atomic<const FoodIndex*> sharedSnapshot(nullptr);
+static atomic<uint32_t> readerEpoch(0);
+static atomic<int> activeReaders[2];             // readers per epoch parity
+static atomic<uint64_t> sharedGeneration(0);     // bumped on every reload
+static map<string, FoodIndex> customOverlays;
+static map<string, uint64_t> overlayGenerations;  // generation each overlay last saw
+static vector<function<void(const string&)>> catalogListeners;
+
+static const char* const catalogFile = "foods.txt";
+static const int watchIntervalSeconds = 2;
+static const size_t minChunkBytes = 1 << 20; // files below 1 MB are parsed on one thread
+
+// --- Parsing ---
+
+// Lower-cases, trims and collapses runs of spaces/tabs into a single space.
+string normalizeFoodName(string_view name) {
+    string out;
+    bool pendingSpace = false;
+    for (char c : name) {
+        if (c == ' ' || c == '\t' || c == '\r') {
+            pendingSpace = !out.empty();
+            continue;
+        }
+        if (pendingSpace) { out += ' '; pendingSpace = false; }
+        out += (char)tolower((unsigned char)c);
+    }
+    return out;
+}
+
+void setFoodName(FoodItem& item, string_view name) {
+    item.nameId = internString(name);
+    item.keyId = internString(normalizeFoodName(name));
+}
+
+// Splits a serving size string like "100g", "200ml", "1pc" into value and unit.
+// Custom foods store a bare number, which means grams.
+static void parseServing(const string& s, float& value, uint32_t& unitId) {
+    string numPart, unitPart;
+    bool readingNum = true;
+    for (char c : trim(s)) {
+        if (readingNum && (isdigit((unsigned char)c) || c == '.')) numPart += c;
+        else { readingNum = false; unitPart += c; }
+    }
+    value = numPart.empty() ? 0.0f : stof(numPart);
+    unitPart = trim(unitPart);
+    unitId = internString(unitPart.empty() ? "g" : unitPart);
+}
+
+// Checks a line's trailing "| #checksum" field, if it has one.
+static bool foodRecordIntact(const string& line) {
+    size_t bar = line.rfind('|');
+    if (bar == string::npos) return true;
+    string tail = trim(line.substr(bar + 1));
+    if (tail.empty() || tail[0] != '#') return true;
+
+    size_t end = bar;
+    while (end > 0 && line[end - 1] == ' ') --end;
+    try {
+        size_t used = 0;
+        uint32_t stored = (uint32_t)stoul(tail.substr(1), &used, 16);
+        return used == tail.size() - 1 && stored == crc32c(line.data(), end);
+    } catch (...) {
+        return false;
+    }
+}
+
+// Shared line parser for foods.txt and the custom foods files, with damage
+// (a checksum mismatch) told apart from other bad lines.
+// The header line fails the numeric conversion and is rejected like any other bad line.
+static bool parseFoodLine(const string& line, FoodItem& item, bool& damaged) {
+    damaged = !foodRecordIntact(line);
+    if (damaged) return false;
+
+    vector<string> parts;
+    size_t pos = 0;
+    while (parts.size() < 6) {
+        size_t bar = line.find('|', pos);
+        parts.push_back(trim(line.substr(pos, bar == string::npos ? string::npos : bar - pos)));
+        if (bar == string::npos) break;
+        pos = bar + 1;
+    }
+    if (parts.size() < 6) return false;
+    return parseFoodDefinition(parts[0], parts.data() + 1, item);
+}
+
+bool parseFoodDefinition(const string& name, const string* fields, FoodItem& item) {
+    string trimmedName = trim(name);
+    if (trimmedName.empty()) return false;
+    try {
+        item.calories = stof(fields[0]);
+        item.protein = stof(fields[1]);
+        item.carbs = stof(fields[2]);
+        item.fat = stof(fields[3]);
+        parseServing(fields[4], item.servingSize, item.unitId);
+    } catch (...) {
+        return false;
+    }
+    setFoodName(item, trimmedName);
+    return true;
+}
+
+bool parseFoodRecord(const string& line, FoodItem& item) {
+    bool damaged;
+    return parseFoodLine(line, item, damaged);
+}
+
+string formatFoodRecord(const FoodItem& food) {
+    stringstream ss;
+    ss << food.name() << " | " << food.calories << " | " << food.protein << " | " << food.carbs << " | "
+       << food.fat << " | " << food.servingSize;
+    string body = ss.str();
+    ss << " | #" << hex << setw(8) << setfill('0') << crc32c(body.data(), body.size());
+    return ss.str();
+}
+
+bool verifyFoodFile(const string& filename, FileCheck& check) {
+    ifstream file(filename, ios::binary);
+    if (!file) {
+        check.problem = "missing";
+        return false;
+    }
+    string line;
+    size_t lineNo = 0, damaged = 0, firstDamaged = 0;
+    while (getline(file, line)) {
+        lineNo++;
+        check.bytes += line.size() + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t bar = line.rfind('|');
+        if (bar == string::npos || trim(line.substr(bar + 1)).rfind('#', 0) != 0) continue;
+        check.checkedBytes += line.size() + 1;
+        if (foodRecordIntact(line)) continue;
+        if (damaged++ == 0) firstDamaged = lineNo;
+    }
+    if (damaged > 0) {
+        check.problem = to_string(damaged) + " line(s) fail their checksum, the first is line " + to_string(firstDamaged);
+    }
+    return damaged == 0;
+}
+
+double nutrientPer100(const FoodItem& f, Nutrient n) {
+    double amount = (n == NUTRIENT_PROTEIN) ? f.protein : (n == NUTRIENT_CARBS) ? f.carbs : f.fat;
+    double norm = (f.servingSize > 0) ? (100.0 / f.servingSize) : 1.0;
+    return amount * norm;
+}
+
+// --- Index maintenance ---
+
+static vector<int>& rankingFor(FoodIndex& idx, Nutrient n) {
+    if (n == NUTRIENT_PROTEIN) return idx.byProtein;
+    if (n == NUTRIENT_CARBS) return idx.byCarbs;
+    return idx.byFat;
+}
+
+static const vector<int>& rankingFor(const FoodIndex& idx, Nutrient n) {
+    if (n == NUTRIENT_PROTEIN) return idx.byProtein;
+    if (n == NUTRIENT_CARBS) return idx.byCarbs;
+    return idx.byFat;
+}
+
+static const Nutrient allNutrients[] = { NUTRIENT_PROTEIN, NUTRIENT_CARBS, NUTRIENT_FAT };
+
+// Sorts one ranking from scratch.
+// The sort keys are computed once up front so the comparisons only touch a
+// compact array instead of the food records.
+static void buildRanking(FoodIndex& idx, Nutrient n) {
+    vector<double> keys(idx.foods.size());
+    for (size_t i = 0; i < idx.foods.size(); ++i) keys[i] = nutrientPer100(idx.foods[i], n);
+
+    vector<int>& ranking = rankingFor(idx, n);
+    ranking.clear();
+    for (int i = 0; i < (int)idx.foods.size(); ++i) ranking.push_back(i);
+    stable_sort(ranking.begin(), ranking.end(), [&](int a, int b) { return keys[a] > keys[b]; });
+}
+
+// Sorts all three rankings from scratch. Used once after a bulk load.
+// Large catalogs sort the three rankings on separate threads.
+static void buildRankings(FoodIndex& idx) {
+    if (idx.foods.size() * sizeof(FoodItem) < minChunkBytes) {
+        for (Nutrient n : allNutrients) buildRanking(idx, n);
+        return;
+    }
+    vector<thread> workers;
+    for (Nutrient n : allNutrients) workers.push_back(thread(buildRanking, ref(idx), n));
+    for (thread& t : workers) t.join();
+}
+
+// Places one position into an existing ranking (after foods with an equal value).
+static void insertRanked(FoodIndex& idx, Nutrient n, int pos) {
+    vector<int>& ranking = rankingFor(idx, n);
+    double value = nutrientPer100(idx.foods[pos], n);
+    auto it = ranking.begin();
+    while (it != ranking.end() && nutrientPer100(idx.foods[*it], n) >= value) ++it;
+    ranking.insert(it, pos);
+}
+
+// Adds a record to foods/byName without touching the rankings.
+// Returns its position, or -1 if the name already exists and replace is false.
+static int storeRecord(FoodIndex& idx, const FoodItem& food, bool replace) {
+    auto inserted = idx.byName.emplace(food.keyId, (int)idx.foods.size());
+    if (!inserted.second) {
+        if (!replace) return -1;
+        idx.foods[inserted.first->second] = food;
+        return inserted.first->second;
+    }
+    idx.foods.push_back(food);
+    return (int)idx.foods.size() - 1;
+}
+
+// Records parsed from one newline-aligned slice of a food file.
+struct ParsedChunk {
+    vector<FoodItem> items;
+    int malformed = 0;
+    int damaged = 0;    // of those, lines that failed their checksum
+};
+
+// Parses the lines in data[begin, end) with the shared line parser.
+static void parseChunk(const string& data, size_t begin, size_t end, bool isCustom, ParsedChunk& out) {
+    size_t pos = begin;
+    while (pos < end) {
+        size_t nl = data.find('\n', pos);
+        if (nl == string::npos || nl > end) nl = end;
+        string line = data.substr(pos, nl - pos);
+        pos = nl + 1;
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (trim(line).empty()) continue;
+        FoodItem item;
+        bool damaged;
+        if (!parseFoodLine(line, item, damaged)) {
+            out.malformed++;
+            out.damaged += damaged;
+            continue;
+        }
+        item.isCustom = isCustom;
+        out.items.push_back(item);
+    }
+}
+
+// Reads a food file into an index.
+// The file is read in one go and cut into newline-aligned chunks, which a small
+// pool of worker threads parses in parallel (each worker takes the next unparsed
+// chunk). The chunks are then merged in file order, so the result is identical
+// to a line-by-line load: duplicate names keep the first record for the shared
+// catalog and the last one for custom foods (a re-added custom food replaces
+// the older definition). Malformed lines are counted per chunk in the index;
+// lines that fail their checksum are among them and reported on stderr. The
+// checksums are checked as part of parsing, on the same worker threads.
+static void loadFoodFile(const string& filename, FoodIndex& idx, bool isCustom) {
+    ifstream file(filename, ios::binary);
+    if (!file) return;
+    string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    file.close();
+
+    // Skip the "foodname|calories|..." header so it is not reported as malformed
+    size_t start = 0;
+    if (toLower(data.substr(0, 8)) == "foodname") {
+        start = data.find('\n');
+        start = (start == string::npos) ? data.size() : start + 1;
+    }
+
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    size_t chunkCount = min((size_t)threads * 4, (data.size() - start) / minChunkBytes + 1);
+
+    // Chunk boundaries: each one moved forward to just past the next newline
+    vector<size_t> bounds(1, start);
+    for (size_t k = 1; k < chunkCount; ++k) {
+        size_t b = start + (data.size() - start) * k / chunkCount;
+        b = data.find('\n', max(b, bounds.back()));
+        b = (b == string::npos) ? data.size() : b + 1;
+        bounds.push_back(b);
+    }
+    bounds.push_back(data.size());
+    chunkCount = bounds.size() - 1;
+
+    vector<ParsedChunk> chunks(chunkCount);
+    atomic<size_t> nextChunk(0);
+    auto worker = [&]() {
+        for (size_t k = nextChunk++; k < chunkCount; k = nextChunk++) {
+            parseChunk(data, bounds[k], bounds[k + 1], isCustom, chunks[k]);
+        }
+    };
+    if (chunkCount == 1) {
+        worker();
+    } else {
+        vector<thread> pool;
+        for (unsigned t = 0; t < min((size_t)threads, chunkCount); ++t) pool.push_back(thread(worker));
+        for (thread& t : pool) t.join();
+    }
+
+    size_t total = 0;
+    int damaged = 0;
+    for (const ParsedChunk& c : chunks) {
+        total += c.items.size();
+        damaged += c.damaged;
+    }
+    if (damaged > 0) reportChecksumMismatch(filename, to_string(damaged) + " food line(s) fail their checksum");
+    idx.foods.reserve(idx.foods.size() + total);
+    idx.byName.reserve(idx.byName.size() + total);
+    for (ParsedChunk& c : chunks) {
+        for (const FoodItem& item : c.items) storeRecord(idx, item, isCustom);
+        idx.malformedPerChunk.push_back(c.malformed);
+        vector<FoodItem>().swap(c.items); // release chunk memory as we go
+    }
+    buildRankings(idx);
+}
+
+// --- Public API ---
+
+// Builds a complete catalog snapshot from foods.txt.
+static unique_ptr<FoodIndex> buildSharedSnapshot() {
+    unique_ptr<FoodIndex> idx(new FoodIndex());
+    loadFoodFile(catalogFile, *idx, false);
+    return idx;
+}
+
+CatalogSnapshot::~CatalogSnapshot() {
+    activeReaders[slot]--;
+}
+
+CatalogSnapshot getSharedCatalog() {
+    // Count in before loading the pointer; if the epoch moved meanwhile, the
+    // publisher may not have seen us, so count in again under the new one
+    uint32_t epoch = readerEpoch.load();
+    while (true) {
+        activeReaders[epoch & 1]++;
+        uint32_t now = readerEpoch.load();
+        if (now == epoch) break;
+        activeReaders[epoch & 1]--;
+        epoch = now;
+    }
+    const FoodIndex* snap = sharedSnapshot.load();
+    if (!snap) {
+        // First use without a watcher: load on the calling thread. If another
+        // thread published first, use theirs.
+        const FoodIndex* built = buildSharedSnapshot().release();
+        if (sharedSnapshot.compare_exchange_strong(snap, built)) {
+            snap = built;
+            if (snap->foods.empty()) cout << "Error opening foods.txt" << endl;
+            for (size_t k = 0; k < snap->malformedPerChunk.size(); ++k) {
+                if (snap->malformedPerChunk[k] > 0) {
+                    cerr << "Warning: skipped " << snap->malformedPerChunk[k]
+                         << " malformed line(s) in foods.txt (chunk " << k + 1 << ")\n";
+                }
+            }
+        } else {
+            delete built;
+        }
+    }
+    return CatalogSnapshot(snap, (int)(epoch & 1));
+}
+
+// Replaces the snapshot and frees the old one once no reader can hold it:
+// readers that counted in under the new epoch load the new pointer, so only
+// the old epoch's slot has to drain. Only the watcher thread publishes.
+static void publishSnapshot(const FoodIndex* fresh) {
+    const FoodIndex* old = sharedSnapshot.exchange(fresh);
+    uint32_t oldEpoch = readerEpoch.fetch_add(1);
+    while (activeReaders[oldEpoch & 1].load() != 0) this_thread::sleep_for(chrono::milliseconds(1));
+    delete old;
+}
+
+// Last modification time of foods.txt, or the default value if it is missing.
+static filesystem::file_time_type catalogStamp() {
+    error_code ec;
+    filesystem::file_time_type t = filesystem::last_write_time(catalogFile, ec);
+    return ec ? filesystem::file_time_type() : t;
+}
+
+static thread catalogWatcher;
+static mutex watcherLock;                  // guards watcherStopping
+static condition_variable watcherWake;
+static bool watcherStopping = false;
+
+// Sleeps one poll interval; false if the watcher is being stopped.
+static bool watcherSleep() {
+    unique_lock<mutex> lock(watcherLock);
+    return !watcherWake.wait_for(lock, chrono::seconds(watchIntervalSeconds), [] { return watcherStopping; });
+}
+
+// Polls foods.txt and republishes the catalog when it changes.
+// A change must be stable for one interval before rebuilding, so a file that is
+// still being written is not picked up half-way. An empty result (unreadable or
+// broken file) keeps the current snapshot.
+static void watchCatalog(filesystem::file_time_type lastStamp) {
+    while (watcherSleep()) {
+        filesystem::file_time_type stamp = catalogStamp();
+        if (stamp == lastStamp) continue;
+
+        if (!watcherSleep()) break;
+        if (catalogStamp() != stamp) continue; // still changing, check again later
+
+        unique_ptr<FoodIndex> fresh = buildSharedSnapshot();
+        lastStamp = stamp;
+        if (fresh->foods.empty()) continue;
+        publishSnapshot(fresh.release());
+        sharedGeneration++;
+    }
+}
+
+void startCatalogWatcher() {
+    if (catalogWatcher.joinable()) return;
+
+    filesystem::file_time_type stamp = catalogStamp();
+    getSharedCatalog();
+    catalogWatcher = thread(watchCatalog, stamp);
+}
+
+void stopCatalogWatcher() {
+    if (!catalogWatcher.joinable()) return;
+    {
+        lock_guard<mutex> guard(watcherLock);
+        watcherStopping = true;
+    }
+    watcherWake.notify_all();
+    catalogWatcher.join();
+}
+
+// Returns the user's overlay, loading it on first use. If the shared catalog was
+// reloaded since the overlay was last used, the listeners run first (on this,
+// the session thread), so they can update foods derived from shared ones.
+static FoodIndex& overlayFor(const string& username) {
+    uint64_t generation = sharedGeneration.load();
+    auto it = customOverlays.find(username);
+    if (it != customOverlays.end()) {
+        uint64_t& seen = overlayGenerations[username];
+        if (seen != generation) {
+            seen = generation;
+            for (const auto& listener : catalogListeners) listener(username);
+        }
+        return it->second;
+    }
+    FoodIndex& idx = customOverlays[username];
+    overlayGenerations[username] = generation;
+    loadFoodFile(userFilePath(username, "custom_foods.txt"), idx, true);
+    return idx;
+}
+
+// Inserts or replaces a record in an overlay and moves it in the rankings.
+static void putRecord(FoodIndex& idx, const FoodItem& food) {
+    int pos = storeRecord(idx, food, true);
+    for (Nutrient n : allNutrients) {
+        vector<int>& ranking = rankingFor(idx, n);
+        ranking.erase(remove(ranking.begin(), ranking.end(), pos), ranking.end());
+        insertRanked(idx, n, pos);
+    }
+}
+
+const FoodIndex& getCustomOverlay(const string& username) {
+    return overlayFor(username);
+}
+
+bool findFood(const string& username, const string& name, FoodItem& out) {
+    uint32_t key = internString(normalizeFoodName(name));
+    const FoodIndex& custom = getCustomOverlay(username);
+    auto it = custom.byName.find(key);
+    if (it != custom.byName.end()) { out = custom.foods[it->second]; return true; }
+
+    CatalogSnapshot snapshot = getSharedCatalog();
+    it = snapshot->byName.find(key);
+    if (it != snapshot->byName.end()) { out = snapshot->foods[it->second]; return true; }
+    return false;
+}
+
+vector<FoodItem> searchFoods(const string& username, const string& searchWord) {
+    CatalogSnapshot snapshot = getSharedCatalog();
+    const FoodIndex& shared = *snapshot;
+    const FoodIndex& custom = getCustomOverlay(username);
+    string sw = normalizeFoodName(searchWord);
+
+    vector<FoodItem> results;
+    for (const FoodItem& f : shared.foods) {
+        if (f.key().find(sw) == string_view::npos) continue;
+        if (custom.byName.count(f.keyId)) continue; // shadowed by the user's own version
+        results.push_back(f);
+    }
+    for (const FoodItem& f : custom.foods) {
+        if (f.key().find(sw) != string_view::npos) results.push_back(f);
+    }
+    return results;
+}
+
+// Merges the shared and custom rankings (both already sorted), so no sorting
+// happens per request.
+vector<FoodItem> foodsRankedBy(const string& username, Nutrient n, double minPer100) {
+    CatalogSnapshot snapshot = getSharedCatalog();
+    const FoodIndex& shared = *snapshot;
+    const FoodIndex& custom = getCustomOverlay(username);
+    const vector<int>& a = rankingFor(shared, n);
+    const vector<int>& b = rankingFor(custom, n);
+
+    vector<FoodItem> out;
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        bool takeCustom;
+        if (i >= a.size()) takeCustom = true;
+        else if (j >= b.size()) takeCustom = false;
+        else takeCustom = nutrientPer100(custom.foods[b[j]], n) > nutrientPer100(shared.foods[a[i]], n);
+
+        const FoodItem& f = takeCustom ? custom.foods[b[j++]] : shared.foods[a[i++]];
+        if (nutrientPer100(f, n) < minPer100) break;
+        if (!takeCustom && custom.byName.count(f.keyId)) continue;
+        out.push_back(f);
+    }
+    return out;
+}
+
+bool addCustomFood(const string& username, const FoodItem& food) {
+    ensureUserDir(username);
+    string customFile = userFilePath(username, "custom_foods.txt");
+    if (!appendToFile(customFile, formatFoodRecord(food) + "\n")) return false;
+
+    FoodItem item = food;
+    item.isCustom = true;
+    item.unitId = internString("g");
+    putRecord(overlayFor(username), item);
+    return true;
+}
+
+void putOverlayFood(const string& username, const FoodItem& food) {
+    FoodItem item = food;
+    item.isCustom = true;
+    putRecord(overlayFor(username), item);
+}
+
+void onSharedCatalogReloaded(function<void(const string&)> listener) {
+    catalogListeners.push_back(listener);
+}
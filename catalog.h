@@ -0,0 +1,115 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "models.h"
+#include "checksum.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <type_traits>
+
+// Nutrients the catalog keeps a ranking index for.
+enum Nutrient {
+    NUTRIENT_PROTEIN,
+    NUTRIENT_CARBS,
+    NUTRIENT_FAT
+};
+
+static_assert(std::is_trivially_copyable<FoodItem>::value, "catalog records must stay trivially copyable");
+
+// An in-memory food table with its lookup indexes.
+// Used both for the shared catalog (foods.txt) and for each user's custom overlay.
+struct FoodIndex {
+    std::vector<FoodItem> foods;                  // records in file order
+    std::unordered_map<uint32_t, int> byName;     // interned normalized name (keyId) -> position in foods
+    std::vector<int> byProtein;                   // positions sorted by protein per 100 units, highest first
+    std::vector<int> byCarbs;                     // positions sorted by carbs per 100 units, highest first
+    std::vector<int> byFat;                       // positions sorted by fat per 100 units, highest first
+    std::vector<int> malformedPerChunk;           // load report: rejected lines per ingest chunk
+};
+
+// Lower-cases, trims and collapses inner whitespace so "Doro  Wat" == "doro wat".
+std::string normalizeFoodName(std::string_view name);
+
+// Sets a food's display name and its normalized lookup key (both interned).
+void setFoodName(FoodItem& item, std::string_view name);
+
+// Parses one "name|calories|protein|carbs|fat|serving[|#checksum]" line.
+// Returns false for headers, malformed lines and lines whose checksum (CRC32C
+// of the text before the last "|", in hex) does not match. Lines without one,
+// as in a hand-edited foods.txt, are taken as they are.
+bool parseFoodRecord(const std::string& line, FoodItem& item);
+
+// Parses a food from its name and the five fields after it (calories,
+// protein, carbs, fat, serving), for files that keep the fields in another
+// order (foodids.cpp). Returns false if the name is empty or a field is not
+// a number.
+bool parseFoodDefinition(const std::string& name, const std::string* fields, FoodItem& item);
+
+// Formats a food as a custom foods line, checksum included.
+std::string formatFoodRecord(const FoodItem& food);
+
+// Checks every line of a food file that carries a checksum, without reporting.
+bool verifyFoodFile(const std::string& filename, FileCheck& check);
+
+// Amount of the nutrient per 100 units of the serving (g, ml, pc).
+double nutrientPer100(const FoodItem& f, Nutrient n);
+
+// A pinned snapshot of the shared catalog. Snapshots are immutable: a reload
+// publishes a new one and frees the old one once no CatalogSnapshot pins it,
+// so hold one only for the length of a lookup or search.
+class CatalogSnapshot {
+public:
+    CatalogSnapshot(const FoodIndex* index, int slot) : index(index), slot(slot) {}
+    ~CatalogSnapshot();
+    CatalogSnapshot(const CatalogSnapshot&) = delete;
+    CatalogSnapshot& operator=(const CatalogSnapshot&) = delete;
+
+    const FoodIndex& operator*() const { return *index; }
+    const FoodIndex* operator->() const { return index; }
+
+private:
+    const FoodIndex* index;
+    int slot;   // reader count it holds (see catalog.cpp)
+};
+
+// The current snapshot of the shared catalog (foods.txt), loaded on first use.
+// Never takes a lock.
+CatalogSnapshot getSharedCatalog();
+
+// Starts a background thread that watches foods.txt and publishes a freshly
+// built snapshot whenever the file changes. Call once at startup.
+void startCatalogWatcher();
+
+// Stops the watcher thread and waits for it. Call before main returns.
+void stopCatalogWatcher();
+
+// The user's custom foods, loaded from their custom_foods.txt on first use.
+const FoodIndex& getCustomOverlay(const std::string& username);
+
+// Finds a food by name, checking the user's overlay before the shared catalog.
+bool findFood(const std::string& username, const std::string& name, FoodItem& out);
+
+// Case-insensitive substring search over the shared catalog and the user's overlay.
+// A custom food hides a shared food with the same normalized name.
+std::vector<FoodItem> searchFoods(const std::string& username, const std::string& searchWord);
+
+// All foods visible to the user, highest nutrient density first,
+// stopping once the nutrient per 100 units drops below minPer100.
+std::vector<FoodItem> foodsRankedBy(const std::string& username, Nutrient n, double minPer100);
+
+// Appends a custom food to the user's file and inserts it into the overlay
+// and its indexes. A custom food with the same normalized name is replaced.
+bool addCustomFood(const std::string& username, const FoodItem& food);
+
+// Inserts or replaces a food in the user's overlay only (nothing is written to
+// the custom foods file). Used for foods stored elsewhere, such as recipes.
+void putOverlayFood(const std::string& username, const FoodItem& food);
+
+// Registers a callback that runs for a user, on the session thread, the first
+// time their overlay is used after foods.txt was reloaded.
+void onSharedCatalogReloaded(std::function<void(const std::string& username)> listener);
+
+#endif
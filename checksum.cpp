@@ -0,0 +1,110 @@
+#include "checksum.h"
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <set>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+using namespace std;
+
+static const uint32_t crc32cPolynomial = 0x82F63B78u;   // Castagnoli, bit-reflected
+
+// --- Table-driven version (slicing by 8) ---
+
+struct Crc32cTables {
+    uint32_t t[8][256];
+
+    Crc32cTables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c >> 1) ^ ((c & 1) ? crc32cPolynomial : 0);
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xff];
+        }
+    }
+};
+
+static uint32_t crc32cSoftware(const uint8_t* p, size_t n, uint32_t crc) {
+    static const Crc32cTables tables;
+    const uint32_t (*t)[256] = tables.t;
+    while (n >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;   // little-endian, like the stored records
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+// --- SSE4.2 version ---
+
+#ifdef CRC32C_X86
+#ifndef _MSC_VER
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t crc32cHardwarePath(const uint8_t* p, size_t n, uint32_t crc) {
+    uint64_t c = crc;
+    while (n >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        n -= 8;
+    }
+    uint32_t c32 = (uint32_t)c;
+    while (n--) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+
+static bool detectSse42() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+bool crc32cHardware() {
+#ifdef CRC32C_X86
+    static const bool supported = detectSse42();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+uint32_t crc32c(const void* data, size_t bytes, uint32_t crc) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+#ifdef CRC32C_X86
+    if (crc32cHardware()) return ~crc32cHardwarePath(p, bytes, crc);
+#endif
+    return ~crc32cSoftware(p, bytes, crc);
+}
+
+// --- Reporting ---
+
+void reportChecksumMismatch(const string& filename, const string& detail) {
+    static mutex reportLock;
+    static set<string> reported;
+    lock_guard<mutex> guard(reportLock);
+    if (!reported.insert(filename).second) return;
+    cerr << "Warning: " << filename << " is damaged (" << detail << "); the damaged part is not used.\n";
+}
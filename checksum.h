@@ -0,0 +1,30 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// CRC32C (Castagnoli) checksums for the stored data: log segment blocks
+// (logstore.h), profile records (profilestore.h) and food records
+// (catalog.h). On x86 CPUs with SSE4.2 the CRC32 instruction is used, eight
+// bytes per step; elsewhere a table-driven version with the same result.
+
+// Continues a checksum over more bytes; start with crc = 0.
+uint32_t crc32c(const void* data, size_t bytes, uint32_t crc = 0);
+
+// True if crc32c runs on the CRC32 instruction.
+bool crc32cHardware();
+
+// What checking one file against its checksums found (see scrub.h).
+struct FileCheck {
+    uint64_t bytes = 0;           // size of the file
+    uint64_t checkedBytes = 0;    // bytes a checksum covered
+    std::string problem;          // empty if nothing is wrong
+};
+
+// Prints a warning about a damaged file to stderr, once per file per run.
+// Thread-safe.
+void reportChecksumMismatch(const std::string& filename, const std::string& detail);
+
+#endif
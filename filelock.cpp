@@ -0,0 +1,173 @@
+#include "filelock.h"
+#include "userdirs.h"
+#include <chrono>
+#include <map>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// A lock this thread holds: the open lock file, the mode it is held in and
+// how many FileLocks share it.
+struct HeldLock {
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+    LockMode mode = LOCK_MODE_SHARED;
+    int depth = 0;
+};
+
+static thread_local map<string, HeldLock> heldLocks;
+
+#ifdef _WIN32
+static bool openLockFile(const string& path, HeldLock& held) {
+    held.handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return held.handle != INVALID_HANDLE_VALUE;
+}
+
+static void acquire(HeldLock& held, LockMode mode) {
+    OVERLAPPED ov = {};
+    LockFileEx(held.handle, mode == LOCK_MODE_EXCLUSIVE ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, MAXDWORD, MAXDWORD, &ov);
+}
+
+static void release(HeldLock& held) {
+    OVERLAPPED ov = {};
+    UnlockFileEx(held.handle, 0, MAXDWORD, MAXDWORD, &ov);
+}
+
+static void closeLockFile(HeldLock& held) {
+    CloseHandle(held.handle);
+}
+#else
+static bool openLockFile(const string& path, HeldLock& held) {
+    held.fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    return held.fd >= 0;
+}
+
+static void acquire(HeldLock& held, LockMode mode) {
+    while (flock(held.fd, mode == LOCK_MODE_EXCLUSIVE ? LOCK_EX : LOCK_SH) != 0 && errno == EINTR) {}
+}
+
+static void release(HeldLock& held) {
+    flock(held.fd, LOCK_UN);
+}
+
+static void closeLockFile(HeldLock& held) {
+    close(held.fd);
+}
+#endif
+
+FileLock::FileLock(const string& lockFile, LockMode mode) : path(lockFile) {
+    HeldLock& held = heldLocks[path];
+    if (held.depth == 0) {
+        if (!openLockFile(path, held)) {
+            heldLocks.erase(path);
+            return;
+        }
+        acquire(held, mode);
+        held.mode = mode;
+    } else if (mode == LOCK_MODE_EXCLUSIVE && held.mode == LOCK_MODE_SHARED) {
+        // Unlocked first, so two sessions upgrading at once cannot deadlock
+        release(held);
+        acquire(held, LOCK_MODE_EXCLUSIVE);
+        held.mode = LOCK_MODE_EXCLUSIVE;
+        upgraded = true;
+    }
+    held.depth++;
+}
+
+FileLock::~FileLock() {
+    auto it = heldLocks.find(path);
+    if (it == heldLocks.end()) return;   // never locked
+    HeldLock& held = it->second;
+    if (--held.depth == 0) {
+        release(held);
+        closeLockFile(held);
+        heldLocks.erase(it);
+    } else if (upgraded) {
+        release(held);
+        acquire(held, LOCK_MODE_SHARED);
+        held.mode = LOCK_MODE_SHARED;
+    }
+}
+
+// --- Appends ---
+
+#ifdef _WIN32
+// The C runtime's append mode seeks to the end and then writes, two steps
+// another session's append can fall between. Appenders instead lock a byte
+// range far past any data (so readers are not blocked), take the file size
+// under it and write there.
+bool appendToFile(const string& filename, const string& data, int64_t* endOffset) {
+    HANDLE h = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    OVERLAPPED appendLock = {};
+    appendLock.OffsetHigh = 0x7FFFFFFF;
+    LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &appendLock);
+
+    bool ok = false;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(h, &size)) {
+        OVERLAPPED at = {};
+        at.Offset = (DWORD)size.QuadPart;
+        at.OffsetHigh = (DWORD)(size.QuadPart >> 32);
+        DWORD written = 0;
+        ok = WriteFile(h, data.data(), (DWORD)data.size(), &written, &at) && written == data.size();
+        if (endOffset) *endOffset = size.QuadPart + written;
+    }
+    UnlockFileEx(h, 0, 1, 0, &appendLock);
+    CloseHandle(h);
+    return ok;
+}
+#else
+// O_APPEND moves to the end and writes in one step.
+bool appendToFile(const string& filename, const string& data, int64_t* endOffset) {
+    int fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    ssize_t written;
+    while ((written = write(fd, data.data(), data.size())) < 0 && errno == EINTR) {}
+    if (endOffset) *endOffset = (int64_t)lseek(fd, 0, SEEK_CUR);
+    close(fd);
+    return written == (ssize_t)data.size();
+}
+#endif
+
+// --- Stamps ---
+
+FileStamp fileStamp(const string& filename) {
+    FileStamp stamp;
+    error_code ec;
+    filesystem::file_time_type time = filesystem::last_write_time(filename, ec);
+    if (ec) return stamp;
+    uintmax_t size = filesystem::file_size(filename, ec);
+    if (ec) return stamp;
+    stamp.time = time;
+    stamp.size = size;
+    return stamp;
+}
+
+bool replaceFile(const string& tmp, const string& filename) {
+    error_code ec;
+    filesystem::file_time_type previous = filesystem::last_write_time(filename, ec);
+    if (!ec && filesystem::last_write_time(tmp, ec) <= previous && !ec) {
+        filesystem::last_write_time(tmp, previous + chrono::microseconds(1), ec);
+    }
+    filesystem::rename(tmp, filename, ec);
+    return !ec;
+}
+
+string userLockFile(const string& username) {
+    return userFilePath(username, "lock");
+}
@@ -0,0 +1,79 @@
+#ifndef FILELOCK_H
+#define FILELOCK_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Advisory file locks that coordinate sessions (processes) working on the
+// same files. Each lock is a small lock file (flock on POSIX, LockFileEx on
+// Windows); the data files themselves are never locked (on Windows, appenders
+// lock a byte range past the end, see appendToFile), so readers that do not
+// take a lock are never blocked.
+//
+// Per user, appends to the food log, together with the usage and trends lines
+// they add, take a shared lock, so several sessions of one user append at the
+// same time. Anything that rewrites a file from what it read (manifest
+// changes, compaction, which also folds the usage and trends lines in, the
+// weight statistics file, profile updates, ID registration) takes an
+// exclusive lock and re-reads the file's current contents under it. Sessions of
+// different users never share a lock file.
+//
+// Locks are re-entrant per thread: a nested lock on the same file is free,
+// and asking for an exclusive lock while holding a shared one upgrades it
+// until the inner lock is released. An upgrade briefly lets other sessions in,
+// so state read under the shared lock must be read again after it.
+
+enum LockMode {
+    LOCK_MODE_SHARED,
+    LOCK_MODE_EXCLUSIVE
+};
+
+// Holds a lock on lockFile (created if missing) for its lifetime; the
+// constructor waits until the lock is granted. If the lock file cannot be
+// opened the work goes ahead unlocked.
+class FileLock {
+public:
+    FileLock(const std::string& lockFile, LockMode mode);
+    ~FileLock();
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    std::string path;
+    bool upgraded = false;
+};
+
+// Appends data to filename (created if missing) so that appends of other
+// sessions under the same shared lock cannot overwrite or split it: O_APPEND
+// on POSIX, on Windows a write at the file size taken under a lock on a byte
+// range past the data. endOffset, if given, receives where the data ends.
+bool appendToFile(const std::string& filename, const std::string& data, int64_t* endOffset = nullptr);
+
+// What a cached copy of a file was read from, to tell whether another session
+// has changed the file since: its modification time and size. An append
+// always changes the size; a file rewritten through replaceFile always gets a
+// later time, even when the clock has not ticked since the last save.
+struct FileStamp {
+    std::filesystem::file_time_type time = std::filesystem::file_time_type::min();
+    uintmax_t size = 0;
+    bool operator==(const FileStamp& o) const { return time == o.time && size == o.size; }
+    bool operator!=(const FileStamp& o) const { return !(*this == o); }
+};
+
+// The file's stamp (the default one if it does not exist).
+FileStamp fileStamp(const std::string& filename);
+
+// Renames tmp over filename, first moving tmp's modification time past
+// filename's if the clock has not (file times tick in milliseconds on some
+// systems, so two saves can otherwise carry the same time).
+bool replaceFile(const std::string& tmp, const std::string& filename);
+
+// The lock file of a user's directory (userdirs.h).
+std::string userLockFile(const std::string& username);
+
+// Lock files of the files all users share.
+const char* const PROFILES_LOCK_FILE = "profiles.lock";
+const char* const FOOD_IDS_LOCK_FILE = "food_ids.lock";
+
+#endif
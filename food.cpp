@@ -11,10 +11,17 @@
 #include <algorithm>
 #include <ctime>
 #include <chrono>
+#include <cmath>
 #include "auth.h"
 #include "profile.h"
 #include "utils.h"
 #include "models.h"
+#include "usage.h"
+#include "catalog.h"
+#include "logstore.h"
+#include "foodids.h"
+#include "meals.h"
+#include "recipes.h"
 using namespace std;
 
 // Helper to safely convert a string to an integer.
@@ -47,192 +54,24 @@ float safeStof(const string& s, float defaultVal = 0.0f) {
     }
 }
 
-// Returns the current system date formatted as a string "YYYY-MM-DD".
-// This is used to tag daily log entries.
-string getTodayDate() {
-    auto now = chrono::system_clock::now();
-    time_t now_time = chrono::system_clock::to_time_t(now);
-    tm* local_time = localtime(&now_time);
-    stringstream ss;
-    ss << (local_time->tm_year + 1900) << "-"
-       << setw(2) << setfill('0') << (local_time->tm_mon + 1) << "-"
-       << setw(2) << setfill('0') << local_time->tm_mday;
-    return ss.str();
-}
-
-
-/* -------------------- Parse profile file -------------------- */
-
-// Reads the user's specific data file (user_USERNAME_data.txt) to populate a UserProfile struct.
-// It searches for lines starting with specific keys like "Name:", "Age:", etc.
-UserProfile parseUserProfile(const string& username) {
-    UserProfile profile;
-    profile.username = username;
-    
-    string filename = "user_" + username + "_data.txt";
-    ifstream file(filename.c_str());
-    
-    if (file) {
-        string line;
-        while (getline(file, line)) {
-            string t = trim(line);
-            if (t.rfind("Name:", 0) == 0) profile.fullName = trim(t.substr(5));
-            else if (t.rfind("Age:", 0) == 0) profile.age = safeStoi(t.substr(4), 0);
-            else if (t.rfind("Gender:", 0) == 0) profile.gender = trim(t.substr(7));
-            else if (t.rfind("Height:", 0) == 0) profile.height_cm = safeStof(t.substr(7), 0.0f);
-            else if (t.rfind("Weight:", 0) == 0) profile.weight_kg = safeStof(t.substr(7), 0.0f);
-            else if (t.rfind("Activity_Level:", 0) == 0) profile.activityLevel = trim(t.substr(15));
-            else if (t.rfind("Daily_Calorie_Target:", 0) == 0) profile.dailyCaloriesTarget = safeStof(t.substr(22), 2362.0f);
-        }
-        file.close();
-    }
-    
-    return profile;
-}
-
-/* -------------------- Food parsing & search -------------------- */
-
-// Parses a single line from the food database file.
-// Format expected: Name | Calories | Protein | Carbs | Fat | ServingSize
-FoodItem parseFoodLine(const string& line) {
-    FoodItem item;
-    stringstream ss(line);
-    string part;
-    
-    // name
-    if (!getline(ss, part, '|')) return item;
-    item.name = trim(part);
-    
-    // calories
-    if (!getline(ss, part, '|')) return item;
-    item.calories = safeStof(part, 0.0f);
-    
-    // protein
-    if (!getline(ss, part, '|')) return item;
-    item.protein = safeStof(part, 0.0f);
-    
-    // carbs
-    if (!getline(ss, part, '|')) return item;
-    item.carbs = safeStof(part, 0.0f);
-    
-    // fat
-    if (!getline(ss, part, '|')) return item;
-    item.fat = safeStof(part, 0.0f);
-    
-    // serving size (last token may include 'g' or '100g' etc.)
-    if (!getline(ss, part)) {
-        part = ""; // nothing
-    }
-    // extract digits+dot
-    string num;
-    for (char c : part) if ((c >= '0' && c <= '9') || c == '.') num.push_back(c);
-    if (!num.empty()) item.servingSize = safeStof(num, 0.0f);
-    else item.servingSize = 0.0f;
-    
-    return item;
-}
-
-// Searches a given file (e.g., foods.txt or custom foods) for a food item by name.
-// Performs a case-insensitive substring match. Returns all matching items in the results vector.
-void searchInFile(const string& filename, const string& searchWord, vector<FoodItem>& results) {
-    ifstream file(filename.c_str());
-    if (!file) return;
-    
-    string line;
-    while (getline(file, line)) {
-        string t = trim(line);
-        if (t.empty()) continue;
-        FoodItem item = parseFoodLine(line);
-        string lw = item.name;
-        for (char &c : lw) c = tolower((unsigned char)c);
-        string sw = searchWord;
-        for (char &c : sw) c = tolower((unsigned char)c);
-        if (lw.find(sw) != string::npos) {
-            results.push_back(item);
-        }
-    }
-    file.close();
-}
-
-/* -------------------- Daily log writer -------------------- */
-
-// Appends a food Log entry to the user's data file.
-// Logic:
-// 1. Reads the ENTIRE file into memory.
-// 2. Scans for a "DAILY_LOG" block matching today's date.
-// 3. If found, inserts the new entry inside that block.
-// 4. If not found, creates a new "DAILY_LOG" block at the end.
-// 5. Overwrites the file with the updated content.
-void saveToDailyLog(const string& filename, const DailyLog& entry) {
-    // Read current file lines
-    vector<string> lines;
-    ifstream inFile(filename);
-    string line;
-    while (getline(inFile, line)) lines.push_back(line);
-    inFile.close();
-
-    string today = getTodayDate();
-
-    // Find today's DAILY_LOG section
-    bool inDailyLog = false;
-    int currentStart = -1;
-    int todayStart = -1, todayEnd = -1;
-    // Iterate through lines to find the relevant section
-    for (int i = 0; i < (int)lines.size(); ++i) {
-        string t = trim(lines[i]);
-        if (t == "DAILY_LOG") { inDailyLog = true; currentStart = i; }
-        else if (inDailyLog && t.rfind("Date:", 0) == 0) {
-            string fileDate = trim(t.substr(5));
-            if (fileDate == today) {
-                todayStart = currentStart;
-                // find corresponding END_DAILY_LOG
-                for (int j = i + 1; j < (int)lines.size(); ++j) {
-                    if (trim(lines[j]) == "END_DAILY_LOG") { todayEnd = j; break; }
-                }
-                break;
-            } else {
-                inDailyLog = false;
-            }
-        }
-    }
-
-    // Build new two-line entry (Type: ... and Food | ...)
-    vector<string> newEntries;
-    newEntries.push_back("Type: " + entry.mealType);
-
-    stringstream fs;
-    fs << fixed << setprecision(1);
-    fs << entry.foodName << " | " << entry.calories << " | "
-       << entry.protein << " | " << entry.carbs << " | "
-       << entry.fat << " | " << entry.grams;
-    newEntries.push_back(fs.str());
-
-    if (todayEnd != -1) {
-        // insert before END_DAILY_LOG to keep it inside the block
-        lines.insert(lines.begin() + todayEnd, newEntries.begin(), newEntries.end());
-    } else {
-        if (!lines.empty()) lines.push_back("");
-        lines.push_back("DAILY_LOG");
-        lines.push_back("Date: " + today);
-        lines.insert(lines.end(), newEntries.begin(), newEntries.end());
-        lines.push_back("END_DAILY_LOG");
-    }
-
-    ofstream out(filename.c_str());
-    for (const string& l : lines) out << l << endl;
-    out.close();
-}
-
 /* -------------------- Add Custom Food -------------------- */
 
 // Prompts the user to define a new custom food item.
-// The new item is appended to "user_USERNAME_custom_foods.txt" for future use.
+// The new item is appended to the user's custom_foods.txt and inserted into the
+// user's in-memory custom overlay, so searches and recommendations see it immediately.
 // It optionally asks the user if they want to immediately add this food to a meal (though the logic is currently just a placeholder).
 void runAddCustomFood(const UserProfile& p) {
     printHeader("ADD CUSTOM FOOD");
     FoodItem newFood;
     
     string input;
+    // A recipe is a custom food built from other foods (see recipes.h).
+    cout << "1. Custom food (enter nutrients)\n2. Recipe (from ingredients)\nChoice [Enter = 1] (or 'b' to go back): ";
+    getline(cin, input);
+    input = trim(input);
+    if (checkForBack(input)) return;
+    if (input == "2") { runAddRecipe(p); return; }
+
     // Name: required, non-empty
     while (true) {
         cout << "Enter food name (or 'b' to go back): ";
@@ -241,7 +80,8 @@ void runAddCustomFood(const UserProfile& p) {
         if (checkForBack(input)) return;
         if (input.empty()) { cout << "Name cannot be empty. Try again.\n"; continue; }
         if (input.size() > 200) { cout << "Name too long. Keep it under 200 chars.\n"; continue; }
-        newFood.name = input;
+        if (input.find('|') != string::npos) { cout << "Name cannot contain '|'. Try again.\n"; continue; }
+        setFoodName(newFood, input);
         break;
     }
 
@@ -305,15 +145,9 @@ void runAddCustomFood(const UserProfile& p) {
         break;
     }
     
-    string customFile = "user_" + p.username + "_custom_foods.txt";
-    ofstream file(customFile, ios::app);
-    
-    if (file) {
-        file << newFood.name << " | " << newFood.calories << " | " 
-             << newFood.protein << " | " << newFood.carbs << " | " 
-             << newFood.fat << " | " << newFood.servingSize << endl;
-        file.close();
-        cout << "\n✓ Custom food saved to " << customFile << "!" << endl;
+    if (addCustomFood(p.username, newFood)) {
+        recipeIngredientChanged(p.username, string(newFood.name()));
+        cout << "\n✓ Custom food saved to your custom foods!" << endl;
     } else {
         cout << "Error saving custom food!" << endl;
     }
@@ -326,7 +160,6 @@ void runAddCustomFood(const UserProfile& p) {
         choice = trim(choice);
         if (checkForBack(choice)) return;
         if (choice == "1") {
-            UserProfile up = parseUserProfile(p.username);
             break;
         } else if (choice == "2" || choice.empty()) {
             break;
@@ -341,14 +174,14 @@ void runAddCustomFood(const UserProfile& p) {
 
 // Primary function to log a food entry.
 // Steps:
-// 1. Select meal type (Breakfast, Lunch, etc.)
-// 2. Search for food in both the main database and user's custom database.
+// 1. Select meal type (Breakfast, Lunch, etc.), then optionally log a saved meal
+//    or repeat yesterday's meal instead (see meals.h).
+// 2. Search for food in the shared catalog and the user's custom overlay (see catalog.h).
 // 3. Select a matching item.
 // 4. Input grams consumed.
 // 5. Calculate nutritional values proportional to the consumed amount relative to the reference serving size.
 void runAddFood(const UserProfile& p) {
     system("cls");
-    string dailyLogFile = "user_" + p.username + "_data.txt";
     
     printHeader("ADD FOOD TO MEAL");
     cout << "Select meal type:\n"
@@ -366,14 +199,9 @@ void runAddFood(const UserProfile& p) {
     int mealChoice = safeStoi(choice, -1);
     if (mealChoice < 1 || mealChoice > 4) { cout << "Invalid meal choice.\n"; return; }
 
-    string mealType;
-    switch (mealChoice) {
-        case 1: mealType = "Breakfast"; break;
-        case 2: mealType = "Lunch"; break;
-        case 3: mealType = "Dinner"; break;
-        case 4: mealType = "Snack"; break;
-        default: mealType = "Unknown"; break;
-    }
+    MealType meal = (MealType)mealChoice; // menu order matches MEAL_BREAKFAST..MEAL_SNACK
+    string mealType = mealTypeName(meal);
+    if (runMealShortcuts(p, meal)) return;
 
     cout << "\nEnter food name to search (or 'b' to go back): ";
     string searchFood;
@@ -382,9 +210,7 @@ void runAddFood(const UserProfile& p) {
     if (checkForBack(searchFood)) return;
     if (searchFood.empty()) { cout << "No search term provided.\n"; return; }
 
-    vector<FoodItem> allResults;
-    searchInFile("foods.txt", searchFood, allResults);
-    searchInFile("user_" + p.username + "_custom_foods.txt", searchFood, allResults);
+    vector<FoodItem> allResults = searchFoods(p.username, searchFood);
 
     if (allResults.empty()) {
         cout << "\nNo matches found!\n1. Add as custom food first\n2. Search again\nChoice: ";
@@ -393,11 +219,22 @@ void runAddFood(const UserProfile& p) {
         return;
     }
 
+    // Rank matches so the foods this user logs often and recently come first.
+    // stable_sort keeps the file order for foods with equal scores.
+    vector<pair<double, FoodItem>> ranked;
+    for (const FoodItem& item : allResults) ranked.push_back({usageScore(p.username, string(item.name())), item});
+    stable_sort(ranked.begin(), ranked.end(),
+                [](const pair<double, FoodItem>& a, const pair<double, FoodItem>& b) { return a.first > b.first; });
+    for (size_t i = 0; i < ranked.size(); ++i) allResults[i] = ranked[i].second;
+
     cout << "\nFound " << allResults.size() << " match(es):\n";
     for (size_t i = 0; i < allResults.size(); ++i) {
-        cout << i+1 << ". " << allResults[i].name 
+        cout << i+1 << ". " << allResults[i].name() 
              << " (" << allResults[i].calories << " cal per " 
-             << (allResults[i].servingSize > 0 ? to_string((int)allResults[i].servingSize) + "g" : "serving") << ")\n";
+             << (allResults[i].servingSize > 0 ? to_string((int)allResults[i].servingSize) + string(allResults[i].unit()) : "serving") << ")";
+        if (allResults[i].isCustom) cout << " [custom]";
+        if (ranked[i].first > 0.0) cout << " ⭐";
+        cout << "\n";
     }
     cout << "0. None of the above / Back\n";
 
@@ -408,14 +245,20 @@ void runAddFood(const UserProfile& p) {
     if (foodChoice < 1 || foodChoice > (int)allResults.size()) { cout << "Invalid selection.\n"; return; }
 
     FoodItem selected = allResults[foodChoice - 1];
-    cout << "\nSelected: " << selected.name << "\n";
+    cout << "\nSelected: " << selected.name() << "\n";
 
     // Ask grams consumed; guard for servingSize==0
+    // If the user has logged this food before, pressing Enter accepts their typical amount.
+    FoodUsage usage = getFoodUsage(p.username, string(selected.name()));
+    int typicalGrams = (int)round(usage.typicalGrams);
     float grams = 0.0f;
     while (true) {
-        cout << "How many grams did you consume? (or 'b' to go back): ";
+        cout << "How many grams did you consume?";
+        if (typicalGrams > 0) cout << " [Enter = " << typicalGrams << "g]";
+        cout << " (or 'b' to go back): ";
         string gramsStr; getline(cin, gramsStr); gramsStr = trim(gramsStr);
         if (checkForBack(gramsStr)) return;
+        if (gramsStr.empty() && typicalGrams > 0) { grams = (float)typicalGrams; break; }
         if (gramsStr.empty()) { cout << "Please enter grams or 'b' to cancel.\n"; continue; }
         float g = safeStof(gramsStr, -1.0f);
         if (g <= 0) { cout << "Enter a positive number for grams.\n"; continue; }
@@ -436,45 +279,160 @@ void runAddFood(const UserProfile& p) {
     float adjustedCarbs = selected.carbs * ratio;
     float adjustedFat = selected.fat * ratio;
 
-    DailyLog entry;
-    entry.mealType = mealType;
-    entry.foodName = selected.name;
-    entry.grams = grams;
-    entry.calories = adjustedCal;
-    entry.protein = adjustedProt;
-    entry.carbs = adjustedCarbs;
-    entry.fat = adjustedFat;
-
-    saveToDailyLog(dailyLogFile, entry);
+    if (!logFood(p.username, selected, grams, meal)) {
+        cout << "\nError writing to log file.\n";
+        return;
+    }
 
     cout << "\n✓ Added to " << mealType << "!\n";
-    cout << "  " << grams << "g of " << selected.name 
+    cout << "  " << grams << "g of " << selected.name() 
          << " (" << adjustedCal << " calories)\n";
     cout << "  Nutrition: " << adjustedProt << "g protein, " 
          << adjustedCarbs << "g carbs, " << adjustedFat << "g fat\n";
 }
 
-// Displays the food consumption log for the current user.
-// Reads the user_USERNAME_data.txt file and prints relevant lines (DAILY_LOG entries).
+// Prints one day of the log as a page: every live entry, numbered, in log
+// order, then the subtotal of each meal and the day's total.
+static void printConsumptionDay(const UserProfile& up, int day, const vector<LogEntry>& entries) {
+    int today = dateToDayNumber(getTodayDate());
+    string title = (day == today) ? "TODAY'S CONSUMPTION" : "CONSUMPTION";
+    printHeader(title, dayNumberToDate(day));
+
+    DayTotals mealTotals[MEAL_AUTO_ADDED + 1];
+    DayTotals dayTotal;
+
+    cout << fixed << setprecision(1);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const LogRecord& r = entries[i].record;
+        if (i == 0) {
+            cout << left << setw(4) << "#" << setw(12) << "Meal" << setw(30) << "Food" << right << setw(8) << "Grams"
+                 << setw(9) << "Kcal" << setw(8) << "Prot" << setw(8) << "Carbs" << setw(8) << "Fat" << "\n";
+            cout << string(87, '-') << "\n";
+        }
+        FoodItem food;
+        FoodRef ref;
+        ref.id = r.foodId;
+        ref.rev = r.foodRev;
+        string name = resolveFood(up.username, ref, food) ? string(food.name()) : "Unknown food";
+        if (name.size() > 28) name = name.substr(0, 25) + "...";
+        uint8_t meal = (r.mealType > MEAL_AUTO_ADDED) ? (uint8_t)MEAL_OTHER : r.mealType;
+        string mealName = (meal == MEAL_AUTO_ADDED) ? "Recommended" : mealTypeName(meal);
+
+        cout << left << setw(4) << i + 1 << setw(12) << mealName << setw(30) << name << right
+             << setw(8) << fromFixed(r.grams) << setw(9) << fromFixed(r.calories)
+             << setw(8) << fromFixed(r.protein) << setw(8) << fromFixed(r.carbs)
+             << setw(8) << fromFixed(r.fat) << "\n";
+        sumLogRecords(&r, 1, mealTotals[meal]);
+        sumLogRecords(&r, 1, dayTotal);
+    }
+
+    if (dayTotal.entries == 0) {
+        cout << "No food logged on this day.\n";
+    } else {
+        cout << "\n" << left << setw(46) << "Meal subtotals" << right << setw(8) << "Items"
+             << setw(9) << "Kcal" << setw(8) << "Prot" << setw(8) << "Carbs" << setw(8) << "Fat" << "\n";
+        cout << string(87, '-') << "\n";
+        for (uint8_t m = MEAL_BREAKFAST; m <= MEAL_AUTO_ADDED + 1; ++m) {
+            uint8_t meal = (m == MEAL_AUTO_ADDED + 1) ? (uint8_t)MEAL_OTHER : m;   // "Other" last
+            const DayTotals& t = mealTotals[meal];
+            if (t.entries == 0) continue;
+            string mealName = (meal == MEAL_AUTO_ADDED) ? "Recommended" : mealTypeName(meal);
+            cout << left << setw(46) << ("  " + mealName) << right << setw(8) << t.entries
+                 << setw(9) << fromFixed(t.calories) << setw(8) << fromFixed(t.protein)
+                 << setw(8) << fromFixed(t.carbs) << setw(8) << fromFixed(t.fat) << "\n";
+        }
+        cout << left << setw(46) << "Day total" << right << setw(8) << dayTotal.entries
+             << setw(9) << fromFixed(dayTotal.calories) << setw(8) << fromFixed(dayTotal.protein)
+             << setw(8) << fromFixed(dayTotal.carbs) << setw(8) << fromFixed(dayTotal.fat) << "\n";
+        cout << "Target: " << (int)up.dailyCaloriesTarget << " kcal, " << (int)up.targetProtein_g
+             << "g protein, " << (int)up.targetCarbs_g << "g carbs, " << (int)up.targetFat_g << "g fat\n";
+    }
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+}
+
+// Asks for an entry number on the current page. Returns its index, or -1.
+static int selectConsumptionEntry(const vector<LogEntry>& entries, const string& action) {
+    if (entries.empty()) return -1;
+    cout << "Entry to " << action << " (1-" << entries.size() << ", 0 to cancel): ";
+    string input;
+    getline(cin, input);
+    int index = safeStoi(trim(input), 0);
+    if (index < 1 || index > (int)entries.size()) return -1;
+    return index - 1;
+}
+
+// Changes the grams of an entry. Nutrients are recomputed from the food
+// revision it was logged with.
+static void editConsumptionEntry(const UserProfile& up, const LogEntry& entry) {
+    const LogRecord& r = entry.record;
+    cout << "New amount in grams [Enter = " << fromFixed(r.grams) << "]: ";
+    string input;
+    getline(cin, input);
+    input = trim(input);
+    if (input.empty()) return;
+    float grams = safeStof(input, -1.0f);
+    if (grams <= 0.0f) { cout << "Please enter a positive number of grams.\n"; pauseConsole(); return; }
+
+    FoodItem food;
+    FoodRef ref;
+    ref.id = r.foodId;
+    ref.rev = r.foodRev;
+    LogRecord updated = r;
+    if (resolveFood(up.username, ref, food)) {
+        updated = makeLogRecord(ref, food, grams, (MealType)r.mealType, r.day);
+    } else if (r.grams > 0) {
+        // Unknown revision: scale the logged amounts
+        double scale = toFixed(grams) / (double)r.grams;
+        updated.grams = toFixed(grams);
+        updated.calories = (int32_t)llround(r.calories * scale);
+        updated.protein = (int32_t)llround(r.protein * scale);
+        updated.carbs = (int32_t)llround(r.carbs * scale);
+        updated.fat = (int32_t)llround(r.fat * scale);
+    }
+    if (!replaceLogEntry(up.username, entry, updated)) {
+        cout << "\nThe entry was not changed: it was changed in another session, or the log could not be written.\n";
+        pauseConsole();
+    }
+}
+
+// Displays the food log one day per page, starting at today.
+// Only the requested day's records are read (see readLogDay in logstore.h),
+// so opening the viewer costs the same however long the history is.
+// Edits and deletes append correction records; nothing is rewritten.
+// Commands: [p] previous day, [n] next day, [d] go to a date, [e] edit an
+// entry, [x] delete an entry, [b] back.
 void runViewConsumption(const UserProfile& up){
-    printHeader("TODAY'S CONSUMPTION");
-                string logfile = "user_" + up.username + "_data.txt";
-                ifstream f(logfile);
-                if (!f) {
-                    cout << "No data found (file missing).\n";
-                } else {
-                    string l;
-                    while (getline(f, l)) {
-                        string t = trim(l);
-                        if (t.find("DAILY_LOG") != string::npos ||
-                            t.find("Date:") != string::npos ||
-                            t.find("Type:") != string::npos ||
-                            t.find("|") != string::npos ||
-                            t.find("END_DAILY_LOG") != string::npos) {
-                            cout << l << "\n";
-                        }
-                    }
-                    f.close();
-                }
+    int day = dateToDayNumber(getTodayDate());
+    while (true) {
+        vector<LogEntry> entries;
+        readLogEntries(up.username, day, entries);
+        printConsumptionDay(up, day, entries);
+        cout << "\n[p] previous day   [n] next day   [d] go to date   [e] edit entry   [x] delete entry   [b] back\nChoice: ";
+        string input;
+        getline(cin, input);
+        input = toLower(trim(input));
+        if (input == "b" || input.empty() || !cin) return;
+        if (input == "p") day--;
+        else if (input == "n") day++;
+        else if (input == "d") {
+            cout << "Date (YYYY-MM-DD): ";
+            getline(cin, input);
+            int target = dateToDayNumber(trim(input));
+            if (target != NO_DAY) day = target;
+        } else if (input == "e") {
+            int index = selectConsumptionEntry(entries, "edit");
+            if (index >= 0) editConsumptionEntry(up, entries[index]);
+        } else if (input == "x") {
+            int index = selectConsumptionEntry(entries, "delete");
+            if (index < 0) continue;
+            cout << "Delete entry " << index + 1 << "? (y/n): ";
+            getline(cin, input);
+            if (toLower(trim(input)) != "y") continue;
+            if (!deleteLogEntry(up.username, entries[index])) {
+                cout << "\nThe entry was not deleted: it was changed in another session, or the log could not be written.\n";
                 pauseConsole();
-}
\ No newline at end of file
+            }
+        }
+    }
+}
@@ -0,0 +1,244 @@
+#include "foodids.h"
+#include "catalog.h"
+#include "filelock.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+// One ID registry (global or per user).
+// byKey maps the interned normalized name to a slot; slot i holds ID i + 1
+// (plus the custom bit) and the list of nutrient revisions, oldest first.
+struct FoodRegistry {
+    string filename;
+    uint32_t idBits = 0;
+    unordered_map<uint32_t, uint32_t> byKey;
+    vector<vector<FoodItem>> revisions;
+    uintmax_t loadedBytes = 0;   // file size when last loaded
+};
+
+static mutex registryLock;
+static FoodRegistry sharedRegistry;
+static bool sharedRegistryLoaded = false;
+static map<string, FoodRegistry> customRegistries;
+
+// --- Persistence ---
+// Format (append-only): id|rev|calories|protein|carbs|fat|serving|name
+// The name goes last so it may contain any character.
+
+static bool sameDefinition(const FoodItem& a, const FoodItem& b) {
+    return a.calories == b.calories && a.protein == b.protein && a.carbs == b.carbs &&
+           a.fat == b.fat && a.servingSize == b.servingSize && a.unitId == b.unitId;
+}
+
+static void loadRegistry(FoodRegistry& reg) {
+    error_code ec;
+    uintmax_t bytes = filesystem::file_size(reg.filename, ec);
+    reg.loadedBytes = ec ? 0 : bytes;
+    ifstream file(reg.filename);
+    string line;
+    while (getline(file, line)) {
+        vector<string> parts;
+        size_t pos = 0;
+        while (parts.size() < 7) {
+            size_t bar = line.find('|', pos);
+            if (bar == string::npos) break;
+            parts.push_back(line.substr(pos, bar - pos));
+            pos = bar + 1;
+        }
+        if (parts.size() < 7) continue;
+
+        // The name is the rest of the line, '|' and all
+        FoodItem food;
+        if (!parseFoodDefinition(line.substr(pos), parts.data() + 2, food)) continue;
+
+        uint32_t id = 0, rev = 0;
+        try {
+            id = (uint32_t)stoul(parts[0]);
+            rev = (uint32_t)stoul(parts[1]);
+        } catch (...) {
+            continue;
+        }
+        uint32_t slot = (id & ~CUSTOM_FOOD_ID_BIT) - 1;
+        if (slot >= reg.revisions.size()) reg.revisions.resize(slot + 1);
+        if (rev != reg.revisions[slot].size()) continue; // out of order: ignore
+        reg.revisions[slot].push_back(food);
+        reg.byKey[food.keyId] = slot;
+    }
+}
+
+// Replaces the registry with what is on disk now. Caller holds the file's lock.
+static void reloadRegistry(FoodRegistry& reg) {
+    reg.byKey.clear();
+    reg.revisions.clear();
+    loadRegistry(reg);
+}
+
+static string registryLockFile(const string& username, bool custom) {
+    return custom ? userLockFile(username) : string(FOOD_IDS_LOCK_FILE);
+}
+
+static void appendRevision(const FoodRegistry& reg, uint32_t id, uint32_t rev, const FoodItem& food) {
+    ofstream out(reg.filename, ios::app);
+    out << id << "|" << rev << "|" << food.calories << "|" << food.protein << "|"
+        << food.carbs << "|" << food.fat << "|" << food.servingSize << food.unit() << "|"
+        << food.name() << "\n";
+}
+
+// Returns the registry a food ID (or a food) belongs to. Caller holds registryLock.
+static FoodRegistry& registryFor(const string& username, bool custom) {
+    if (!custom) {
+        if (!sharedRegistryLoaded) {
+            sharedRegistry.filename = "food_ids.txt";
+            loadRegistry(sharedRegistry);
+            sharedRegistryLoaded = true;
+        }
+        return sharedRegistry;
+    }
+    auto it = customRegistries.find(username);
+    if (it != customRegistries.end()) return it->second;
+    FoodRegistry& reg = customRegistries[username];
+    reg.filename = userFilePath(username, "food_ids.txt");
+    reg.idBits = CUSTOM_FOOD_ID_BIT;
+    loadRegistry(reg);
+    return reg;
+}
+
+// --- Public API ---
+
+// True if registering the food would add to the registry file.
+static bool needsNewEntry(const FoodRegistry& reg, const FoodItem& food) {
+    auto it = reg.byKey.find(food.keyId);
+    return it == reg.byKey.end() || reg.revisions[it->second].empty() ||
+           !sameDefinition(reg.revisions[it->second].back(), food);
+}
+
+FoodRef registerFood(const string& username, const FoodItem& food) {
+    lock_guard<mutex> guard(registryLock);
+    FoodRegistry& reg = registryFor(username, food.isCustom);
+
+    // IDs and revisions are positions in the file, so before adding one the
+    // registry is reloaded under the file's lock to see what other sessions
+    // have added since
+    unique_ptr<FileLock> fileLock;
+    if (needsNewEntry(reg, food)) {
+        if (food.isCustom) ensureUserDir(username);
+        fileLock.reset(new FileLock(registryLockFile(username, food.isCustom), LOCK_MODE_EXCLUSIVE));
+        reloadRegistry(reg);
+    }
+
+    FoodRef ref;
+    auto it = reg.byKey.find(food.keyId);
+    uint32_t slot;
+    if (it == reg.byKey.end()) {
+        slot = (uint32_t)reg.revisions.size();
+        reg.revisions.push_back(vector<FoodItem>());
+        reg.byKey[food.keyId] = slot;
+    } else {
+        slot = it->second;
+    }
+    ref.id = (slot + 1) | reg.idBits;
+
+    vector<FoodItem>& revs = reg.revisions[slot];
+    if (revs.empty() || !sameDefinition(revs.back(), food)) {
+        revs.push_back(food);
+        appendRevision(reg, ref.id, (uint32_t)revs.size() - 1, food);
+    }
+    ref.rev = (uint32_t)revs.size() - 1;
+    return ref;
+}
+
+bool resolveFood(const string& username, FoodRef ref, FoodItem& out) {
+    if (ref.id == 0) return false;
+    lock_guard<mutex> guard(registryLock);
+    bool custom = (ref.id & CUSTOM_FOOD_ID_BIT) != 0;
+    FoodRegistry& reg = registryFor(username, custom);
+    uint32_t slot = (ref.id & ~CUSTOM_FOOD_ID_BIT) - 1;
+    auto known = [&reg, slot, ref]() { return slot < reg.revisions.size() && ref.rev < reg.revisions[slot].size(); };
+    if (!known()) {
+        // Possibly registered by another session since this one loaded the
+        // file: reload once if it has grown (appends hold the exclusive lock)
+        FileLock fileLock(registryLockFile(username, custom), LOCK_MODE_SHARED);
+        error_code ec;
+        uintmax_t bytes = filesystem::file_size(reg.filename, ec);
+        if (ec || bytes == reg.loadedBytes) return false;
+        reloadRegistry(reg);
+        if (!known()) return false;
+    }
+    out = reg.revisions[slot][ref.rev];
+    return true;
+}
+
+string formatLogEntryLine(FoodRef ref, double grams) {
+    stringstream ss;
+    ss << "@";
+    if (ref.id & CUSTOM_FOOD_ID_BIT) ss << "c" << (ref.id & ~CUSTOM_FOOD_ID_BIT);
+    else ss << ref.id;
+    if (ref.rev > 0) ss << ":" << ref.rev;
+    ss << fixed << setprecision(1) << " | " << grams;
+    return ss.str();
+}
+
+bool parseLogEntryLine(const string& username, const string& line, LoggedFood& out) {
+    string t = trim(line);
+    size_t bar = t.find('|');
+    if (bar == string::npos || t.rfind("Type:", 0) == 0) return false;
+
+    if (t[0] == '@') {
+        // Compact entry: nutrients come from the registered revision
+        FoodRef ref;
+        double grams = 0.0;
+        try {
+            size_t used = 0;
+            string idPart = trim(t.substr(1, bar - 1));
+            bool custom = !idPart.empty() && idPart[0] == 'c';
+            if (custom) idPart = idPart.substr(1);
+            ref.id = (uint32_t)stoul(idPart, &used);
+            if (custom) ref.id |= CUSTOM_FOOD_ID_BIT;
+            if (used < idPart.size() && idPart[used] == ':') ref.rev = (uint32_t)stoul(idPart.substr(used + 1));
+            grams = stod(trim(t.substr(bar + 1)));
+        } catch (...) {
+            return false;
+        }
+
+        FoodItem food;
+        if (!resolveFood(username, ref, food)) return false;
+        double ratio = (food.servingSize > 0) ? grams / food.servingSize : 1.0;
+        out.ref = ref;
+        out.name = string(food.name());
+        out.grams = grams;
+        out.calories = food.calories * ratio;
+        out.protein = food.protein * ratio;
+        out.carbs = food.carbs * ratio;
+        out.fat = food.fat * ratio;
+        return true;
+    }
+
+    // Legacy entry: "name | cal | protein | carbs | fat | grams"
+    vector<string> parts;
+    stringstream ss(t);
+    string segment;
+    while (getline(ss, segment, '|')) parts.push_back(trim(segment));
+    if (parts.size() < 5) return false;
+    try {
+        out.ref = FoodRef();
+        out.name = parts[0];
+        out.calories = stod(parts[1]);
+        out.protein = stod(parts[2]);
+        out.carbs = stod(parts[3]);
+        out.fat = stod(parts[4]);
+        out.grams = parts.size() > 5 ? stod(parts[5]) : 0.0;
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
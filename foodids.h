@@ -0,0 +1,51 @@
+#ifndef FOODIDS_H
+#define FOODIDS_H
+
+#include "models.h"
+#include <string>
+#include <cstdint>
+
+// Stable numeric food IDs and the nutrient revisions behind them.
+//
+// Shared foods are registered in food_ids.txt and custom foods in
+// the user's food_ids.txt (their IDs have CUSTOM_FOOD_ID_BIT set).
+// An ID belongs to a normalized food name forever. The nutrients behind it are
+// kept as revisions: a new revision is written only when the catalog entry has
+// changed since the food was last logged, so old log entries keep the values
+// they were logged with.
+
+const uint32_t CUSTOM_FOOD_ID_BIT = 0x80000000u;
+
+// Reference to one revision of a food.
+struct FoodRef {
+    uint32_t id = 0;   // 0 = not a registered food
+    uint32_t rev = 0;
+};
+
+// One food line of a DAILY_LOG block, with nutrients scaled to the amount eaten.
+struct LoggedFood {
+    FoodRef ref;             // id 0 for legacy text lines
+    std::string name;
+    double grams = 0.0;
+    double calories = 0.0;
+    double protein = 0.0;
+    double carbs = 0.0;
+    double fat = 0.0;
+};
+
+// Returns the ID and current revision for a catalog food, registering the
+// name and/or a new nutrient revision if needed.
+FoodRef registerFood(const std::string& username, const FoodItem& food);
+
+// Looks up the food definition (per-serving nutrients) behind a reference.
+bool resolveFood(const std::string& username, FoodRef ref, FoodItem& out);
+
+// Log line for a registered food: "@<id> | <grams>" or "@<id>:<rev> | <grams>".
+// Custom food IDs are written as "c<n>" (e.g. "@c3 | 150.0").
+std::string formatLogEntryLine(FoodRef ref, double grams);
+
+// Parses a log food line, either "@<id>[:<rev>] | <grams>" or the legacy
+// "name | cal | protein | carbs | fat | grams" form.
+bool parseLogEntryLine(const std::string& username, const std::string& line, LoggedFood& out);
+
+#endif
@@ -0,0 +1,244 @@
+#include "lockstress.h"
+#include "catalog.h"
+#include "foodids.h"
+#include "logstore.h"
+#include "profilestore.h"
+#include "usage.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const char* const stressSharedFood = "Stress shared food";
+static const int stressCustomFoods = 3;      // custom foods per worker
+static const int stressProfileEvery = 4;     // a profile update every 4th entry
+static const int stressCompactEvery = 16;
+static const int stressGramsPerWorker = 100000;
+static const float stressStartWeight = 50.0f;
+
+static FoodItem stressFood(const string& name, bool custom) {
+    FoodItem food;
+    setFoodName(food, name);
+    food.calories = 100.0f;
+    food.protein = 10.0f;
+    food.carbs = 10.0f;
+    food.fat = 1.0f;
+    food.servingSize = 100.0f;
+    food.unitId = internString("g");   // as read back from food_ids.txt, so no new revision per process
+    food.isCustom = custom;
+    return food;
+}
+
+static string customFoodName(int worker, int k) {
+    return "Stress w" + to_string(worker) + " " + to_string(k);
+}
+
+static bool isCustomEntry(int i) {
+    return i % 4 == 1;
+}
+
+// The grams of an entry say which worker logged it and when, so the checks
+// can account for every one.
+static int entryGrams(int worker, int i) {
+    return worker * stressGramsPerWorker + i + 1;
+}
+
+// --- Worker ---
+
+void runLockStressWorker(const string& username, int worker, int entries) {
+    int today = dateToDayNumber(getTodayDate());
+    FoodItem shared = stressFood(stressSharedFood, false);
+    UserProfile p;
+    p.username = username;
+    for (int i = 0; i < entries; ++i) {
+        FoodItem food = isCustomEntry(i) ? stressFood(customFoodName(worker, i % stressCustomFoods), true) : shared;
+        FoodRef ref = registerFood(username, food);
+        LogRecord r = makeLogRecord(ref, food, entryGrams(worker, i), MEAL_SNACK, today - i % 3);
+        logRecords(username, vector<LogRecord>(1, r));
+
+        if (i % stressProfileEvery == 0) {
+            updateProfile(p, [](UserProfile& stored) { stored.weight_kg += 0.1f; });
+        }
+        if (i % stressCompactEvery == stressCompactEvery - 1) compactLog(username);
+    }
+}
+
+// --- Checks ---
+
+static bool check(ostream& out, bool ok, const string& username, const string& what) {
+    if (!ok) out << "  FAILED " << username << ": " << what << "\n";
+    return ok;
+}
+
+static bool verifyUser(ostream& out, const string& username, const vector<int>& workers, int entries) {
+    int today = dateToDayNumber(getTodayDate());
+    vector<LogRecord> records;
+    scanLog(username, today - 2, today, [&records](const LogRecord& r) { records.push_back(r); });
+
+    // Every entry exactly once, with the food it was logged with
+    map<int, int> seen;
+    int sharedEntries = 0;
+    bool foodsOk = true;
+    map<int, int> perDay;
+    for (const LogRecord& r : records) {
+        int grams = (int)(fromFixed(r.grams) + 0.5);
+        seen[grams]++;
+        perDay[r.day]++;
+        int worker = (grams - 1) / stressGramsPerWorker;
+        int i = (grams - 1) % stressGramsPerWorker;
+        FoodItem food;
+        FoodRef ref;
+        ref.id = r.foodId;
+        ref.rev = r.foodRev;
+        string expected = isCustomEntry(i) ? customFoodName(worker, i % stressCustomFoods) : stressSharedFood;
+        if (!resolveFood(username, ref, food) || string(food.name()) != expected) foodsOk = false;
+        if (!isCustomEntry(i)) sharedEntries++;
+    }
+    bool entriesOk = records.size() == workers.size() * (size_t)entries;
+    for (int w : workers) {
+        for (int i = 0; i < entries; ++i) entriesOk &= seen[entryGrams(w, i)] == 1;
+    }
+
+    // Day reads rely on the out-of-order marks in the manifest
+    bool daysOk = true;
+    for (int day = today - 2; day <= today; ++day) daysOk &= getDayTotals(username, day).entries == perDay[day];
+
+    int updates = (int)workers.size() * ((entries + stressProfileEvery - 1) / stressProfileEvery);
+    ProfileRecord profile;
+    uint32_t id = findUserId(username);
+    bool profileOk = id != NO_USER_ID && readProfileRecord(id, profile) &&
+                     profile.weightDg == (int)lround(stressStartWeight * 10) + updates;
+
+    bool ok = check(out, entriesOk, username, to_string(records.size()) + " entries, expected " +
+                                              to_string(workers.size() * entries));
+    ok &= check(out, foodsOk, username, "an entry resolves to another worker's food");
+    ok &= check(out, daysOk, username, "day totals disagree with the full scan");
+    ok &= check(out, getFoodUsage(username, stressSharedFood).count == sharedEntries, username,
+                "usage count " + to_string(getFoodUsage(username, stressSharedFood).count) + ", expected " +
+                to_string(sharedEntries));
+    ok &= check(out, profileOk, username, "profile weight " + to_string(profile.weightDg) + " dg, expected " +
+                                          to_string((int)lround(stressStartWeight * 10) + updates));
+    return ok;
+}
+
+// --- Rounds ---
+
+// Runs one worker process per entry of users (user of worker w = users[w])
+// at the same time and returns the elapsed time in ms.
+static double runWorkers(const string& program, const vector<string>& users, int entries) {
+    auto start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (size_t w = 0; w < users.size(); ++w) {
+        string command = "\"" + program + "\" --lock-stress-worker " + users[w] + " " + to_string(w) + " " +
+                         to_string(entries);
+#ifdef _WIN32
+        command = "\"" + command + "\"";   // cmd.exe strips the outer quotes
+#endif
+        pool.push_back(thread([command]() { (void)system(command.c_str()); }));
+    }
+    for (thread& t : pool) t.join();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static bool runRound(ostream& out, const string& program, const string& title, const vector<string>& users,
+                     int entries) {
+    map<string, vector<int>> workersOf;
+    for (size_t w = 0; w < users.size(); ++w) workersOf[users[w]].push_back((int)w);
+    for (const auto& user : workersOf) {
+        UserProfile p;
+        p.username = user.first;
+        p.fullNameId = internString("Stress User");
+        p.age = 30;
+        p.height_cm = 170;
+        p.weight_kg = stressStartWeight;
+        writeProfile(p);
+    }
+
+    double ms = runWorkers(program, users, entries);
+    bool ok = true;
+    for (const auto& user : workersOf) ok &= verifyUser(out, user.first, user.second, entries);
+    out << left << title << users.size() << " sessions x " << entries << " entries on " << workersOf.size()
+        << " user(s): " << fixed << setprecision(0) << ms << " ms, " << (ok ? "ok" : "FAILED") << "\n";
+    out.unsetf(ios::fixed);
+    return ok;
+}
+
+// --- Corrections ---
+
+// Entries read before a compaction (which sorts the day by meal, so the
+// entries are numbered differently) are still the ones deleted and edited.
+static bool runCorrectionCheck(ostream& out) {
+    string username = "stressfix";
+    int today = dateToDayNumber(getTodayDate());
+    FoodItem food = stressFood(stressSharedFood, false);
+    FoodRef ref = registerFood(username, food);
+    LogRecord snack = makeLogRecord(ref, food, 10, MEAL_SNACK, today);
+    LogRecord breakfast = makeLogRecord(ref, food, 30, MEAL_BREAKFAST, today);
+    logRecords(username, vector<LogRecord>(1, snack));
+    logRecords(username, vector<LogRecord>(1, breakfast));
+
+    vector<LogEntry> read;
+    readLogEntries(username, today, read);
+    compactLog(username);
+    bool deleted = read.size() == 2 && deleteLogEntry(username, read[0]);
+    bool deletedTwice = read.size() == 2 && deleteLogEntry(username, read[0]);
+    vector<LogEntry> remaining;
+    readLogEntries(username, today, remaining);
+    bool ok = check(out, deleted && !deletedTwice, username, "delete after compaction not resolved");
+    ok &= check(out, remaining.size() == 1 && remaining[0].record.mealType == MEAL_BREAKFAST &&
+                     getDayTotals(username, today).calories == breakfast.calories,
+                username, "delete after compaction cancelled the wrong entry");
+
+    LogRecord edited = makeLogRecord(ref, food, 50, MEAL_BREAKFAST, today);
+    compactLog(username);
+    bool replaced = remaining.size() == 1 && replaceLogEntry(username, remaining[0], edited);
+    vector<LogEntry> now;
+    readLogEntries(username, today, now);
+    ok &= check(out, replaced && now.size() == 1 && now[0].record.grams == edited.grams &&
+                     getDayTotals(username, today).calories == edited.calories,
+                username, "edit after compaction changed the wrong entry");
+    out << left << "Corrections:    delete and edit after another session's compaction: "
+        << (ok ? "ok" : "FAILED") << "\n";
+    return ok;
+}
+
+bool runLockStress(ostream& out, const string& program, int sessions, int entries) {
+    sessions = max(sessions, 2);
+    entries = max(entries, 1);
+    error_code ec;
+    filesystem::path exe(program);
+    if (exe.has_parent_path()) exe = filesystem::absolute(exe, ec);   // else found on the PATH
+    filesystem::path home = filesystem::current_path();
+    filesystem::path root = home / "lock_stress";
+    filesystem::remove_all(root, ec);
+    filesystem::create_directories(root, ec);
+    filesystem::current_path(root, ec);
+    if (ec) {
+        out << "Could not create " << root.string() << ".\n";
+        return false;
+    }
+    ensureDataLayout();   // before the workers start, so none of them migrates
+
+    out << "LOCK STRESS TEST\n\n";
+    vector<string> ownUsers, oneUser;
+    for (int w = 0; w < sessions; ++w) {
+        ownUsers.push_back("stress" + to_string(w));
+        oneUser.push_back("stressall");
+    }
+    bool ok = runRound(out, exe.string(), "Separate users: ", ownUsers, entries);
+    ok &= runRound(out, exe.string(), "Same user:      ", oneUser, entries);
+    ok &= runCorrectionCheck(out);
+    out << (ok ? "\nNo lost updates.\n" : "\nUpdates were lost.\n");
+
+    filesystem::current_path(home, ec);
+    filesystem::remove_all(root, ec);
+    return ok;
+}
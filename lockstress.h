@@ -0,0 +1,27 @@
+#ifndef LOCKSTRESS_H
+#define LOCKSTRESS_H
+
+#include <iostream>
+#include <string>
+
+// Concurrent-session stress test for the file locks (filelock.h).
+//
+// The program is started again as a number of worker processes, in two
+// rounds: first every worker on a user of its own, then all of them on one
+// user. Each worker logs entries one at a time (some for earlier days, so
+// segments go out of day order, and some with custom foods of its own that
+// need new IDs), compacts the log now and then, and bumps the stored weight
+// with updateProfile. Afterwards every entry, day total, usage count, custom
+// food ID and profile update is checked, so a lost update shows up as a
+// failed check. Last, a log entry read before a compaction is deleted and
+// edited, which must still hit that entry. Runs in a scratch directory (lock_stress/) that is removed
+// afterwards.
+
+// "--lock-stress [sessions] [entries]": returns false if a check failed.
+// program is argv[0], used to start the workers.
+bool runLockStress(std::ostream& out, const std::string& program, int sessions, int entries);
+
+// "--lock-stress-worker <user> <worker> <entries>": one worker process.
+void runLockStressWorker(const std::string& username, int worker, int entries);
+
+#endif
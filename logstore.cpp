@@ -0,0 +1,1175 @@
+#include "logstore.h"
+#include "foodids.h"
+#include "catalog.h"
+#include "filelock.h"
+#include "usage.h"
+#include "trends.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+static const char logMagic[4] = { 'N', 'L', 'O', 'G' };
+static const uint32_t logVersion = 1;        // plain LogRecord array
+static const uint32_t packedLogVersion = 2;  // columnar blocks without checksums (read only)
+static const uint32_t checkedLogVersion = 3; // columnar blocks with a checksum each
+static const size_t readBatchRecords = 4096;
+static const streamoff logHeaderBytes = 8;   // magic + version
+
+static_assert(sizeof(LogRecord) == 32, "LogRecord is a fixed 32-byte on-disk record");
+
+// --- Helpers ---
+
+int32_t toFixed(double value) {
+    return (int32_t)llround(value * 10.0);
+}
+
+double fromFixed(int64_t value) {
+    return value / 10.0;
+}
+
+static const char* const mealNames[] = {
+    "Other", "Breakfast", "Lunch", "Dinner", "Snack", "Auto-Added Recommendation"
+};
+
+string mealTypeName(uint8_t mealType) {
+    if (mealType > MEAL_AUTO_ADDED) return mealNames[MEAL_OTHER];
+    return mealNames[mealType];
+}
+
+MealType parseMealType(const string& name) {
+    string n = toLower(trim(name));
+    for (uint8_t m = MEAL_BREAKFAST; m <= MEAL_AUTO_ADDED; ++m) {
+        if (toLower(mealNames[m]) == n) return (MealType)m;
+    }
+    return MEAL_OTHER;
+}
+
+// --- Packed (columnar) blocks ---
+// Sealed segments use format version 3: the header is followed by blocks of up
+// to readBatchRecords records, each a [count][payload bytes][CRC32C of the
+// payload] triple of uint32s (version 2, written before checksums, has only the
+// first two) and a payload holding one column after another:
+//   day      runs of (zigzag delta from the previous run's day, length)
+//   foodId   varint of (number << 1 | custom bit)
+//   foodRev  varint
+//   meal     runs of (value, length)
+//   flags    runs of (value, length)
+//   grams    zigzag varint
+//   calories, protein, carbs, fat   zigzag varint deltas from a prediction:
+//            the previous record of the same food revision in the block,
+//            scaled to this record's grams (0 for the first one)
+// Blocks are self-contained, so the reader can decode one batch at a time.
+
+static void putVarint(string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char)v);
+}
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Writes a column as (value, length) runs; deltaCoded stores each run value
+// as the difference from the previous run.
+template <typename Get>
+static void putRuns(string& out, size_t n, Get get, bool deltaCoded) {
+    vector<pair<int32_t, uint32_t>> runs;
+    for (size_t i = 0; i < n; ++i) {
+        int32_t v = get(i);
+        if (!runs.empty() && runs.back().first == v) runs.back().second++;
+        else runs.push_back(make_pair(v, 1u));
+    }
+    putVarint(out, (uint32_t)runs.size());
+    int32_t prev = 0;
+    for (const auto& run : runs) {
+        putVarint(out, deltaCoded ? zigzag(run.first - prev) : (uint32_t)run.first);
+        putVarint(out, run.second);
+        prev = run.first;
+    }
+}
+
+template <typename Set>
+static bool getRuns(const uint8_t*& p, const uint8_t* end, size_t n, Set set, bool deltaCoded) {
+    uint32_t runCount;
+    if (!getVarint(p, end, runCount)) return false;
+    size_t i = 0;
+    int32_t prev = 0;
+    for (uint32_t r = 0; r < runCount; ++r) {
+        uint32_t raw, len;
+        if (!getVarint(p, end, raw) || !getVarint(p, end, len) || len > n - i) return false;
+        int32_t v = deltaCoded ? prev + unzigzag(raw) : (int32_t)raw;
+        for (uint32_t k = 0; k < len; ++k) set(i++, v);
+        prev = v;
+    }
+    return i == n;
+}
+
+// For each record, the index of the previous record in the block with the same
+// food revision, or -1.
+static void findPreviousSameFood(const LogRecord* rec, size_t n, vector<int32_t>& prevIndex) {
+    unordered_map<uint64_t, int32_t> last;
+    prevIndex.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t key = ((uint64_t)rec[i].foodId << 16) | rec[i].foodRev;
+        auto it = last.find(key);
+        if (it == last.end()) {
+            prevIndex[i] = -1;
+            last.emplace(key, (int32_t)i);
+        } else {
+            prevIndex[i] = it->second;
+            it->second = (int32_t)i;
+        }
+    }
+}
+
+// Predicted amount for record i: the earlier record's amount scaled by grams.
+static int32_t predictNutrient(const LogRecord* rec, int32_t prev, size_t i, int32_t LogRecord::* field) {
+    if (prev < 0 || rec[prev].grams <= 0) return 0;
+    int64_t scaled = (int64_t)(rec[prev].*field) * rec[i].grams;
+    int64_t g = rec[prev].grams;
+    return (int32_t)((scaled >= 0 ? scaled + g / 2 : scaled - g / 2) / g);
+}
+
+static int32_t LogRecord::* const nutrientFields[] = { &LogRecord::calories, &LogRecord::protein,
+                                                       &LogRecord::carbs, &LogRecord::fat };
+
+static void encodeLogBlock(const LogRecord* rec, size_t n, string& out) {
+    string payload;
+    putRuns(payload, n, [rec](size_t i) { return rec[i].day; }, true);
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t id = rec[i].foodId;
+        putVarint(payload, ((id & ~CUSTOM_FOOD_ID_BIT) << 1) | ((id & CUSTOM_FOOD_ID_BIT) ? 1u : 0u));
+    }
+    for (size_t i = 0; i < n; ++i) putVarint(payload, rec[i].foodRev);
+    putRuns(payload, n, [rec](size_t i) { return (int32_t)rec[i].mealType; }, false);
+    putRuns(payload, n, [rec](size_t i) { return (int32_t)rec[i].flags; }, false);
+    for (size_t i = 0; i < n; ++i) putVarint(payload, zigzag(rec[i].grams));
+
+    vector<int32_t> prevIndex;
+    findPreviousSameFood(rec, n, prevIndex);
+    for (int32_t LogRecord::* field : nutrientFields) {
+        for (size_t i = 0; i < n; ++i) {
+            putVarint(payload, zigzag(rec[i].*field - predictNutrient(rec, prevIndex[i], i, field)));
+        }
+    }
+
+    uint32_t header[3] = { (uint32_t)n, (uint32_t)payload.size(), crc32c(payload.data(), payload.size()) };
+    out.append((const char*)header, sizeof(header));
+    out.append(payload);
+}
+
+static bool decodeLogBlock(const uint8_t* p, const uint8_t* end, size_t n, vector<LogRecord>& out) {
+    out.resize(n);
+    LogRecord* rec = out.data();
+    uint32_t v;
+
+    if (!getRuns(p, end, n, [rec](size_t i, int32_t d) { rec[i].day = d; }, true)) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (!getVarint(p, end, v)) return false;
+        rec[i].foodId = (v >> 1) | ((v & 1) ? CUSTOM_FOOD_ID_BIT : 0u);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (!getVarint(p, end, v)) return false;
+        rec[i].foodRev = (uint16_t)v;
+    }
+    if (!getRuns(p, end, n, [rec](size_t i, int32_t m) { rec[i].mealType = (uint8_t)m; }, false)) return false;
+    if (!getRuns(p, end, n, [rec](size_t i, int32_t f) { rec[i].flags = (uint8_t)f; }, false)) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (!getVarint(p, end, v)) return false;
+        rec[i].grams = unzigzag(v);
+    }
+
+    vector<int32_t> prevIndex;
+    findPreviousSameFood(rec, n, prevIndex);
+    for (int32_t LogRecord::* field : nutrientFields) {
+        for (size_t i = 0; i < n; ++i) {
+            if (!getVarint(p, end, v)) return false;
+            rec[i].*field = predictNutrient(rec, prevIndex[i], i, field) + unzigzag(v);
+        }
+    }
+    return true;
+}
+
+// --- Reader / writer ---
+
+// Checks the records at the top of a plain segment against the checksum in
+// its manifest entry. The file is positioned just after the header.
+static bool checkPlainSegment(ifstream& file, const LogSegment& segment, string& damage) {
+    uint32_t crc = 0;
+    vector<char> buffer;
+    for (uint32_t done = 0; done < segment.checkedRecords;) {
+        uint32_t n = min<uint32_t>(segment.checkedRecords - done, (uint32_t)readBatchRecords);
+        buffer.resize(n * sizeof(LogRecord));
+        if (!file.read(buffer.data(), buffer.size())) {
+            damage = "shorter than the " + to_string(segment.checkedRecords) + " records of its checksum";
+            return false;
+        }
+        crc = crc32c(buffer.data(), buffer.size(), crc);
+        done += n;
+    }
+    if (crc != segment.checksum) {
+        damage = "checksum mismatch in its first " + to_string(segment.checkedRecords) + " records";
+        return false;
+    }
+    return true;
+}
+
+// openLogReader without reporting damage (verifyLogSegment reports its own way).
+static bool openSegment(LogReader& reader, const string& filename, const LogSegment* segment) {
+    reader.filename = filename;
+    reader.damage.clear();
+    reader.file.open(filename, ios::binary);
+    if (!reader.file) return false;
+
+    char magic[4];
+    uint32_t version = 0;
+    reader.file.read(magic, 4);
+    reader.file.read((char*)&version, sizeof(version));
+    if (!reader.file || memcmp(magic, logMagic, 4) != 0 || version < logVersion || version > checkedLogVersion) {
+        reader.file.close();
+        return false;
+    }
+    reader.version = version;
+    reader.packed = (version != logVersion);
+    reader.batch.clear();
+    reader.next = 0;
+
+    if (segment && !reader.packed && segment->checkedRecords > 0) {
+        if (!checkPlainSegment(reader.file, *segment, reader.damage)) {
+            reader.file.close();
+            return false;
+        }
+        reader.file.seekg(logHeaderBytes);
+    }
+    return true;
+}
+
+bool openLogReader(LogReader& reader, const string& filename, const LogSegment* segment) {
+    if (openSegment(reader, filename, segment)) return true;
+    if (!reader.damage.empty()) reportChecksumMismatch(filename, reader.damage);
+    return false;
+}
+
+// Loads the next batch: a raw slice of records, or one decoded block.
+// A block that is cut short or fails its checksum ends the segment early.
+static bool readLogBatch(LogReader& reader) {
+    reader.next = 0;
+    if (!reader.packed) {
+        reader.batch.resize(readBatchRecords);
+        reader.file.read((char*)reader.batch.data(), readBatchRecords * sizeof(LogRecord));
+        reader.batch.resize((size_t)reader.file.gcount() / sizeof(LogRecord));
+        return !reader.batch.empty();
+    }
+
+    reader.batch.clear();
+    uint32_t header[3] = { 0, 0, 0 };
+    size_t headerBytes = (reader.version == checkedLogVersion ? 3 : 2) * sizeof(uint32_t);
+    reader.file.read((char*)header, headerBytes);
+    if (reader.file.gcount() == 0) return false;   // end of the segment
+    if (!reader.file || header[0] == 0 || header[0] > readBatchRecords) {
+        reader.damage = "broken block header";
+        return false;
+    }
+    reader.block.resize(header[1]);
+    reader.file.read(&reader.block[0], header[1]);
+    if (!reader.file) {
+        reader.damage = "last block cut short";
+        return false;
+    }
+    if (reader.version == checkedLogVersion && crc32c(reader.block.data(), reader.block.size()) != header[2]) {
+        reader.damage = "block checksum mismatch";
+        return false;
+    }
+    const uint8_t* p = (const uint8_t*)reader.block.data();
+    if (!decodeLogBlock(p, p + reader.block.size(), header[0], reader.batch)) {
+        reader.batch.clear();
+        reader.damage = "block does not decode";
+        return false;
+    }
+    return true;
+}
+
+bool readLogRecord(LogReader& reader, LogRecord& out) {
+    if (reader.next >= reader.batch.size()) {
+        if (!reader.file.is_open() || !readLogBatch(reader)) {
+            if (!reader.damage.empty()) reportChecksumMismatch(reader.filename, reader.damage);
+            return false;
+        }
+    }
+    out = reader.batch[reader.next++];
+    return true;
+}
+
+bool verifyLogSegment(const string& filename, const LogSegment& segment, FileCheck& check) {
+    error_code ec;
+    check.bytes = filesystem::file_size(filename, ec);
+    if (ec) {
+        check.problem = "missing";
+        return false;
+    }
+    LogReader reader;
+    if (!openSegment(reader, filename, &segment)) {
+        check.problem = reader.damage.empty() ? "not a log segment" : reader.damage;
+        return false;
+    }
+
+    if (!reader.packed) {
+        // Records past the checked ones get their checksum at the next compaction
+        check.checkedBytes = logHeaderBytes + (uint64_t)segment.checkedRecords * sizeof(LogRecord);
+        if ((check.bytes - logHeaderBytes) % sizeof(LogRecord) != 0) {
+            check.problem = "ends in a record left half written";
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t records = 0;
+    while (readLogBatch(reader)) records += reader.batch.size();
+    if (!reader.damage.empty()) {
+        check.problem = reader.damage;
+        return false;
+    }
+    if (reader.version == checkedLogVersion) check.checkedBytes = check.bytes;
+    if (segment.sealed && records != segment.records) {
+        check.problem = "holds " + to_string(records) + " records, the manifest says " + to_string(segment.records);
+        return false;
+    }
+    return true;
+}
+
+bool appendLogRecords(const string& filename, const vector<LogRecord>& records, streamoff* endOffset) {
+    bool isNew;
+    {
+        ifstream probe(filename, ios::binary);
+        isNew = !probe || probe.peek() == ifstream::traits_type::eof();
+    }
+
+    // Header and records are assembled first so they reach the file in one write
+    string buffer;
+    if (isNew) {
+        buffer.append(logMagic, 4);
+        buffer.append((const char*)&logVersion, sizeof(logVersion));
+    }
+    buffer.append((const char*)records.data(), records.size() * sizeof(LogRecord));
+
+    // Lands at the end of the file as it is then (another session may have
+    // appended meanwhile), so the offset after it is where these records end
+    int64_t end = 0;
+    if (!appendToFile(filename, buffer, &end)) return false;
+    if (endOffset) *endOffset = (streamoff)end;
+    return true;
+}
+
+// --- Segments and manifest ---
+
+// Month key ("YYYY-MM") of a day number.
+string monthOfDay(int day) {
+    return dayNumberToDate(day).substr(0, 7);
+}
+
+static int monthFirstDay(const string& month) {
+    return dateToDayNumber(month + "-01");
+}
+
+static int monthLastDay(const string& month) {
+    // 31 days after the 1st is always inside the following month
+    return monthFirstDay(monthOfDay(monthFirstDay(month) + 31)) - 1;
+}
+
+string logSegmentFileName(const string& username, const string& month) {
+    return userFilePath(username, "log_" + month + ".dat");
+}
+
+static string manifestFileName(const string& username) {
+    return userFilePath(username, "log_manifest.txt");
+}
+
+// Single-file log written before monthly segments; only read for migration.
+static string legacyLogFileName(const string& username) {
+    return userFilePath(username, "log.dat");
+}
+
+// Manifests are cached per user; segments are kept sorted by month. The
+// file's stamp (filelock.h) is kept with each, so a manifest another session
+// has saved since is loaded again.
+static map<string, vector<LogSegment>> manifests;
+static map<string, FileStamp> manifestTimes;
+static map<string, uint64_t> manifestGenerations;
+
+static FileStamp manifestTime(const string& username) {
+    return fileStamp(manifestFileName(username));
+}
+
+// Format, one segment per line:
+//   YYYY-MM|active[|unsortedFrom[|checkedRecords|checksum]]   (-1: sorted; checksum in hex)
+//   YYYY-MM|sealed|records|firstDate|lastDate
+static bool loadManifest(const string& username, vector<LogSegment>& segments) {
+    ifstream file(manifestFileName(username));
+    if (!file) return false;
+
+    string line;
+    while (getline(file, line)) {
+        vector<string> parts;
+        stringstream ss(trim(line));
+        string part;
+        while (getline(ss, part, '|')) parts.push_back(trim(part));
+        if (parts.size() < 2 || parts[0].size() != 7 || monthFirstDay(parts[0]) < 0) continue;
+
+        LogSegment seg;
+        seg.month = parts[0];
+        seg.firstDay = monthFirstDay(seg.month);
+        seg.lastDay = monthLastDay(seg.month);
+        if (parts[1] == "sealed" && parts.size() >= 5) {
+            seg.sealed = true;
+            try {
+                seg.records = (uint32_t)stoul(parts[2]);
+            } catch (...) {
+                seg.records = 0;
+            }
+            int first = dateToDayNumber(parts[3]);
+            int last = dateToDayNumber(parts[4]);
+            if (first != NO_DAY && last != NO_DAY && last >= first) {
+                seg.firstDay = first;
+                seg.lastDay = last;
+            }
+        } else if (parts.size() >= 3) {
+            try {
+                seg.unsortedFrom = stoi(parts[2]);
+            } catch (...) {
+                seg.unsortedFrom = 0;   // unknown: treat the whole segment as unsorted
+            }
+            if (parts.size() >= 5) {
+                try {
+                    seg.checkedRecords = (uint32_t)stoul(parts[3]);
+                    seg.checksum = (uint32_t)stoul(parts[4], nullptr, 16);
+                } catch (...) {
+                    seg.checkedRecords = 0;   // nothing to check against
+                }
+            }
+        }
+        segments.push_back(seg);
+    }
+    sort(segments.begin(), segments.end(),
+         [](const LogSegment& a, const LogSegment& b) { return a.month < b.month; });
+    return true;
+}
+
+// Rewrites the manifest through a temporary file so a crash never leaves it half written.
+static bool saveManifest(const string& username, const vector<LogSegment>& segments) {
+    string filename = manifestFileName(username);
+    string tmp = filename + ".tmp";
+    {
+        ofstream out(tmp, ios::trunc);
+        if (!out) return false;
+        for (const LogSegment& seg : segments) {
+            out << seg.month << "|";
+            if (seg.sealed) {
+                out << "sealed|" << seg.records << "|" << dayNumberToDate(seg.firstDay) << "|"
+                    << dayNumberToDate(seg.lastDay) << "\n";
+            } else if (seg.checkedRecords > 0) {
+                out << "active|" << seg.unsortedFrom << "|" << seg.checkedRecords << "|" << hex
+                    << setw(8) << setfill('0') << seg.checksum << dec << setfill(' ') << "\n";
+            } else if (seg.unsortedFrom >= 0) {
+                out << "active|" << seg.unsortedFrom << "\n";
+            } else {
+                out << "active\n";
+            }
+        }
+        if (!out) return false;
+    }
+    bool replaced = replaceFile(tmp, filename);
+    manifestTimes[username] = manifestTime(username);
+    manifestGenerations[username]++;
+    return replaced;
+}
+
+static void setSegmentReadOnly(const string& filename, bool readOnly) {
+    const filesystem::perms writeBits =
+        filesystem::perms::owner_write | filesystem::perms::group_write | filesystem::perms::others_write;
+    error_code ec;
+    filesystem::permissions(filename, filesystem::perms::owner_write,
+                            readOnly ? filesystem::perm_options::remove : filesystem::perm_options::add, ec);
+    if (readOnly) filesystem::permissions(filename, writeBits, filesystem::perm_options::remove, ec);
+}
+
+// Reads all records of a segment, checked against segment if given. Returns
+// its format version, or 0 if it is missing or damaged.
+static uint32_t readSegment(const string& filename, vector<LogRecord>& records, const LogSegment* segment = nullptr) {
+    LogReader reader;
+    if (!openLogReader(reader, filename, segment)) return 0;
+    LogRecord r;
+    while (readLogRecord(reader, r)) records.push_back(r);
+    return reader.damage.empty() ? reader.version : 0;
+}
+
+// The checksum a manifest entry keeps for the records of an open segment.
+static void setSegmentChecksum(LogSegment& seg, const vector<LogRecord>& records) {
+    seg.checkedRecords = (uint32_t)records.size();
+    seg.checksum = crc32c(records.data(), records.size() * sizeof(LogRecord));
+}
+
+// Rewrites a segment, plain or packed, through a temporary file and a rename.
+static bool rewriteSegment(const string& filename, const vector<LogRecord>& records, bool packed) {
+    string tmp = filename + ".tmp";
+    error_code ec;
+    filesystem::remove(tmp, ec);
+    if (!packed) {
+        if (!appendLogRecords(tmp, records)) return false;
+    } else {
+        string buffer(logMagic, 4);
+        buffer.append((const char*)&checkedLogVersion, sizeof(checkedLogVersion));
+        for (size_t i = 0; i < records.size(); i += readBatchRecords) {
+            encodeLogBlock(records.data() + i, min(readBatchRecords, records.size() - i), buffer);
+        }
+        ofstream out(tmp, ios::binary | ios::trunc);
+        out.write(buffer.data(), buffer.size());
+        if (!out) return false;
+    }
+    filesystem::rename(tmp, filename, ec);
+    return !ec;
+}
+
+// Returns the manifest entry for a month, creating it (and saving the manifest)
+// if the month has no segment yet. A sealed month that receives a new record
+// is reopened and unpacked so records can be appended again.
+static LogSegment& segmentForMonth(const string& username, const string& month) {
+    vector<LogSegment>& segments = manifests[username];
+    auto it = lower_bound(segments.begin(), segments.end(), month,
+                          [](const LogSegment& s, const string& m) { return s.month < m; });
+    if (it != segments.end() && it->month == month) {
+        if (it->sealed) {
+            it->sealed = false;
+            it->firstDay = monthFirstDay(month);
+            it->lastDay = monthLastDay(month);
+            string filename = logSegmentFileName(username, month);
+            setSegmentReadOnly(filename, false);
+            vector<LogRecord> records;
+            if (readSegment(filename, records) && rewriteSegment(filename, records, false)) {
+                setSegmentChecksum(*it, records);
+            }
+            saveManifest(username, segments);
+        }
+        return *it;
+    }
+
+    // The file is created with its header here, so appends (which may run in
+    // several sessions at once) never have to write one
+    LogSegment seg;
+    seg.month = month;
+    seg.firstDay = monthFirstDay(month);
+    seg.lastDay = monthLastDay(month);
+    it = segments.insert(it, seg);
+    appendLogRecords(logSegmentFileName(username, month), vector<LogRecord>());
+    saveManifest(username, segments);
+    return *it;
+}
+
+// The manifest entry for a month, or nullptr.
+static LogSegment* findSegment(const string& username, const string& month) {
+    vector<LogSegment>& segments = manifests[username];
+    auto it = lower_bound(segments.begin(), segments.end(), month,
+                          [](const LogSegment& s, const string& m) { return s.month < m; });
+    return (it != segments.end() && it->month == month) ? &*it : nullptr;
+}
+
+// --- Migration ---
+
+// Finds an ID for a food read from an old text line. Catalog foods use their
+// catalog ID; foods no longer in the catalog are registered as custom foods
+// with the logged values rescaled per 100 g.
+static FoodRef refForLegacyFood(const string& username, const LoggedFood& food) {
+    if (food.ref.id != 0) return food.ref;
+
+    FoodItem item;
+    if (findFood(username, food.name, item)) return registerFood(username, item);
+
+    double scale = (food.grams > 0) ? 100.0 / food.grams : 1.0;
+    setFoodName(item, food.name);
+    item.calories = (float)(food.calories * scale);
+    item.protein = (float)(food.protein * scale);
+    item.carbs = (float)(food.carbs * scale);
+    item.fat = (float)(food.fat * scale);
+    item.servingSize = (food.grams > 0) ? 100.0f : 1.0f;
+    item.isCustom = true;
+    return registerFood(username, item);
+}
+
+// Reads the DAILY_LOG blocks of the user's text data file.
+static void readTextLog(const string& username, vector<LogRecord>& records) {
+    ifstream text(userFilePath(username, "data.txt"));
+    string line;
+    int day = NO_DAY;
+    MealType meal = MEAL_OTHER;
+    while (getline(text, line)) {
+        string t = trim(line);
+        if (t.rfind("Date:", 0) == 0) { day = dateToDayNumber(t.substr(5)); continue; }
+        if (t.rfind("Type:", 0) == 0) { meal = parseMealType(t.substr(5)); continue; }
+        if (day == NO_DAY) continue;
+
+        LoggedFood food;
+        if (!parseLogEntryLine(username, t, food)) continue;
+        FoodRef ref = refForLegacyFood(username, food);
+
+        LogRecord r;
+        r.day = day;
+        r.foodId = ref.id;
+        r.foodRev = (uint16_t)ref.rev;
+        r.mealType = meal;
+        r.grams = toFixed(food.grams);
+        r.calories = toFixed(food.calories);
+        r.protein = toFixed(food.protein);
+        r.carbs = toFixed(food.carbs);
+        r.fat = toFixed(food.fat);
+        records.push_back(r);
+    }
+}
+
+void ensureLogMigrated(const string& username) {
+    auto cached = manifests.find(username);
+    if (cached != manifests.end()) {
+        if (manifestTimes[username] == manifestTime(username)) return;
+        // Saved by another session since it was loaded
+        manifestTimes[username] = manifestTime(username);
+        manifestGenerations[username]++;
+        cached->second.clear();
+        loadManifest(username, cached->second);
+        return;
+    }
+    vector<LogSegment>& segments = manifests[username];
+    manifestTimes[username] = manifestTime(username);
+    if (loadManifest(username, segments)) return;
+
+    // Another session may be migrating: wait for it, then look again
+    FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    manifestTimes[username] = manifestTime(username);
+    if (loadManifest(username, segments)) return;
+
+    // No manifest yet: split the single-file binary log (or, before that, the
+    // text DAILY_LOG blocks) into monthly segments. Old files are left in place.
+    vector<LogRecord> records;
+    LogReader reader;
+    if (openLogReader(reader, legacyLogFileName(username))) {
+        LogRecord r;
+        while (readLogRecord(reader, r)) records.push_back(r);
+    } else {
+        readTextLog(username, records);
+    }
+
+    map<string, vector<LogRecord>> byMonth;
+    for (const LogRecord& r : records) byMonth[monthOfDay(r.day)].push_back(r);
+    for (const auto& month : byMonth) {
+        appendLogRecords(logSegmentFileName(username, month.first), month.second);
+        LogSegment seg;
+        seg.month = month.first;
+        seg.firstDay = monthFirstDay(month.first);
+        seg.lastDay = monthLastDay(month.first);
+        segments.push_back(seg);
+    }
+    saveManifest(username, segments);
+}
+
+uint64_t logManifestGeneration(const string& username) {
+    return manifestGenerations[username];
+}
+
+bool readLogManifest(const string& username, vector<LogSegment>& segments) {
+    segments.clear();
+    return loadManifest(username, segments);
+}
+
+const vector<LogSegment>& getLogSegments(const string& username) {
+    ensureLogMigrated(username);
+    return manifests[username];
+}
+
+// --- Writing entries ---
+
+LogRecord makeLogRecord(FoodRef ref, const FoodItem& food, double grams, MealType meal, int day) {
+    double ratio = (food.servingSize > 0) ? grams / food.servingSize : 1.0;
+    LogRecord r;
+    r.day = day;
+    r.foodId = ref.id;
+    r.foodRev = (uint16_t)ref.rev;
+    r.mealType = meal;
+    r.grams = toFixed(grams);
+    r.calories = toFixed(food.calories * ratio);
+    r.protein = toFixed(food.protein * ratio);
+    r.carbs = toFixed(food.carbs * ratio);
+    r.fat = toFixed(food.fat * ratio);
+    return r;
+}
+
+// Day reads binary-search a segment, so the manifest notes where records
+// start arriving out of day order (a correction of an earlier day). Everything
+// from there on is read linearly until compaction sorts the segment again.
+// The check runs after the write and compares with the record that actually
+// landed before the batch, which may come from another session.
+static bool appendedInOrder(const string& filename, streamoff first, const vector<LogRecord>& records) {
+    if (!is_sorted(records.begin(), records.end(),
+                   [](const LogRecord& a, const LogRecord& b) { return a.day < b.day; })) {
+        return false;
+    }
+    if (first <= 0) return true;
+    ifstream file(filename, ios::binary);
+    int32_t previousDay = 0;
+    file.seekg(logHeaderBytes + (first - 1) * (streamoff)sizeof(LogRecord));
+    file.read((char*)&previousDay, sizeof(previousDay));
+    return file && records.front().day >= previousDay;
+}
+
+// Makes sure the month's segment exists and is not sealed, under the user's
+// exclusive lock if it has to be created or reopened. Returns true if the
+// exclusive lock was taken: the shared lock held around the call was let go
+// meanwhile, so what the caller checked before may have changed.
+static bool openSegment(const string& username, const string& month) {
+    bool reopened = false;
+    while (true) {
+        ensureLogMigrated(username);
+        LogSegment* seg = findSegment(username, month);
+        if (seg && !seg->sealed) return reopened;
+        FileLock manifestLock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+        ensureLogMigrated(username);
+        segmentForMonth(username, month);
+        reopened = true;
+    }
+}
+
+// Appends one month's records to its open segment. first is set to the
+// position of the first record, or -1 if the records need marking out of order.
+static bool appendToSegment(const string& username, const string& month, const vector<LogRecord>& records,
+                            streamoff& first) {
+    string filename = logSegmentFileName(username, month);
+    streamoff end = 0;
+    if (!appendLogRecords(filename, records, &end)) return false;
+    first = (end - logHeaderBytes) / (streamoff)sizeof(LogRecord) - (streamoff)records.size();
+    if (appendedInOrder(filename, first, records)) first = -1;
+    return true;
+}
+
+static void markOutOfOrder(const string& username, const string& month, streamoff first) {
+    FileLock manifestLock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    ensureLogMigrated(username);
+    LogSegment* seg = findSegment(username, month);
+    // Compacted meanwhile (sorted, perhaps sealed): nothing to mark
+    if (!seg || seg->sealed || (seg->unsortedFrom >= 0 && seg->unsortedFrom <= first)) return;
+    seg->unsortedFrom = (int32_t)max<streamoff>(first, 0);
+    saveManifest(username, manifests[username]);
+}
+
+// Sessions append side by side under the user's shared lock. Everything that
+// takes the exclusive lock (opening segments, marking records out of order)
+// happens before the first write or after the last, so compaction sees either
+// all of a batch (records, usage and trend lines) or none of it.
+bool logRecords(const string& username, const vector<LogRecord>& records) {
+    ensureLogMigrated(username);
+    if (records.empty()) return true;
+
+    // One write per month touched (a batch for today is a single write)
+    map<string, vector<LogRecord>> byMonth;
+    for (const LogRecord& r : records) byMonth[monthOfDay(r.day)].push_back(r);
+
+    vector<pair<string, double>> foods;
+    for (const LogRecord& r : records) {
+        if (r.flags != 0) continue;   // corrections are not new uses of a food
+        FoodItem food;
+        FoodRef ref;
+        ref.id = r.foodId;
+        ref.rev = r.foodRev;
+        if (resolveFood(username, ref, food)) foods.push_back(make_pair(string(food.name()), fromFixed(r.grams)));
+    }
+
+    ensureUserDir(username);
+    FileLock lock(userLockFile(username), LOCK_MODE_SHARED);
+    for (bool reopened = true; reopened;) {
+        reopened = false;
+        for (const auto& month : byMonth) reopened |= openSegment(username, month.first);
+    }
+    bool hadTrends = hasTrendState(username);
+
+    vector<pair<string, streamoff>> outOfOrder;
+    for (const auto& month : byMonth) {
+        streamoff first = -1;
+        if (!appendToSegment(username, month.first, month.second, first)) return false;
+        if (first >= 0) outOfOrder.push_back(make_pair(month.first, first));
+    }
+    recordFoodUsage(username, foods, dayNumberToDate(records.back().day));
+    recordTrendDays(username, records, hadTrends);
+
+    for (const auto& mark : outOfOrder) markOutOfOrder(username, mark.first, mark.second);
+    return true;
+}
+
+bool logFood(const string& username, const FoodItem& food, double grams, MealType meal) {
+    FoodRef ref = registerFood(username, food);
+    LogRecord r = makeLogRecord(ref, food, grams, meal, dateToDayNumber(getTodayDate()));
+    return logRecords(username, vector<LogRecord>(1, r));
+}
+
+// --- Compaction ---
+
+static bool recordOrder(const LogRecord& a, const LogRecord& b) {
+    if (a.day != b.day) return a.day < b.day;
+    return a.mealType < b.mealType;
+}
+
+void compactLog(const string& username) {
+    FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    ensureLogMigrated(username);
+    vector<LogSegment>& segments = manifests[username];
+    string currentMonth = monthOfDay(dateToDayNumber(getTodayDate()));
+    bool manifestChanged = false;
+
+    for (LogSegment& seg : segments) {
+        string filename = logSegmentFileName(username, seg.month);
+        vector<LogRecord> records;
+        uint32_t version = readSegment(filename, records, &seg);
+        if (version == 0) continue;   // missing or damaged: left for inspection
+        if (seg.sealed && version == checkedLogVersion) continue;
+
+        // Corrections refer to entries by their position in file order, so they
+        // are folded in before anything moves
+        bool folded = foldLogCorrections(records);
+
+        // Entries of one day (e.g. auto-added items between meals) are brought
+        // together and grouped by meal, keeping the order they were logged in
+        bool sorted = is_sorted(records.begin(), records.end(), recordOrder);
+        if (!sorted) stable_sort(records.begin(), records.end(), recordOrder);
+
+        // A record cut short by an interrupted append is dropped by the rewrite
+        bool seal = seg.sealed || seg.month < currentMonth;
+        error_code ec;
+        bool torn = version == logVersion &&
+                    filesystem::file_size(filename, ec) != logHeaderBytes + records.size() * sizeof(LogRecord);
+        if (seal || !sorted || folded || torn) {
+            if (seg.sealed) setSegmentReadOnly(filename, false);
+            if (!rewriteSegment(filename, records, seal)) continue;
+        }
+        if (seg.unsortedFrom >= 0) {
+            seg.unsortedFrom = -1;
+            manifestChanged = true;
+        }
+
+        if (!seal && (seg.checkedRecords != records.size() ||
+                      seg.checksum != crc32c(records.data(), records.size() * sizeof(LogRecord)))) {
+            setSegmentChecksum(seg, records);
+            manifestChanged = true;
+        }
+        if (seal) {
+            seg.sealed = true;
+            seg.checkedRecords = 0;
+            seg.checksum = 0;
+            seg.records = (uint32_t)records.size();
+            if (!records.empty()) {
+                seg.firstDay = records.front().day;
+                seg.lastDay = records.back().day;
+            }
+            setSegmentReadOnly(filename, true);
+            manifestChanged = true;
+        }
+    }
+    if (manifestChanged) saveManifest(username, segments);
+
+    compactFoodUsage(username);
+    compactTrendDays(username);
+}
+
+// --- Aggregation ---
+
+void sumLogRecords(const LogRecord* records, size_t n, DayTotals& totals) {
+    int64_t cal = 0, prot = 0, carb = 0, fat = 0;
+    int32_t tombstones = 0;
+    for (size_t i = 0; i < n; ++i) {
+        cal += records[i].calories;
+        prot += records[i].protein;
+        carb += records[i].carbs;
+        fat += records[i].fat;
+        tombstones += records[i].flags & LOG_FLAG_TOMBSTONE;
+    }
+    totals.calories += cal;
+    totals.protein += prot;
+    totals.carbs += carb;
+    totals.fat += fat;
+    totals.entries += (int32_t)n - 2 * tombstones;
+}
+
+uint64_t readLogTail(const string& username, const LogSegment& segment, uint64_t from, vector<LogRecord>& records) {
+    FileLock lock(userLockFile(username), LOCK_MODE_SHARED);
+    LogReader reader;
+    if (!openLogReader(reader, logSegmentFileName(username, segment.month), from == 0 ? &segment : nullptr)) {
+        return from;
+    }
+    uint64_t position = 0;
+    if (!reader.packed) {
+        reader.file.seekg(logHeaderBytes + (streamoff)from * (streamoff)sizeof(LogRecord));
+        position = from;
+    }
+    LogRecord r;
+    for (; readLogRecord(reader, r); ++position) {
+        if (position >= from) records.push_back(r);
+    }
+    return max(position, from);
+}
+
+void scanLog(const string& username, int firstDay, int lastDay,
+             const function<void(const LogRecord&)>& visit) {
+    FileLock lock(userLockFile(username), LOCK_MODE_SHARED);
+    for (const LogSegment& seg : getLogSegments(username)) {
+        if (seg.lastDay < firstDay || seg.firstDay > lastDay) continue;
+
+        LogReader reader;
+        if (!openLogReader(reader, logSegmentFileName(username, seg.month), &seg)) continue;
+        LogRecord r;
+        while (readLogRecord(reader, r)) {
+            if (r.day >= firstDay && r.day <= lastDay) visit(r);
+        }
+    }
+}
+
+bool readLogDay(const string& username, int day, vector<LogRecord>& records) {
+    FileLock lock(userLockFile(username), LOCK_MODE_SHARED);
+    ensureLogMigrated(username);
+    const vector<LogSegment>& segments = manifests[username];
+    string month = monthOfDay(day);
+    auto seg = lower_bound(segments.begin(), segments.end(), month,
+                           [](const LogSegment& s, const string& m) { return s.month < m; });
+    if (seg == segments.end() || seg->month != month) return false;
+
+    LogReader reader;
+    if (!openLogReader(reader, logSegmentFileName(username, month))) return false;
+    LogRecord r;
+    if (reader.packed) {
+        // A sealed month is a few blocks and holds no corrections
+        while (readLogRecord(reader, r) && r.day <= day) {
+            if (r.day == day) records.push_back(r);
+        }
+        return true;
+    }
+
+    // Records before unsortedFrom are in day order: binary search the first one of the day
+    reader.file.seekg(0, ios::end);
+    streamoff count = ((streamoff)reader.file.tellg() - logHeaderBytes) / (streamoff)sizeof(LogRecord);
+    streamoff sortedEnd = (seg->unsortedFrom >= 0) ? min<streamoff>(seg->unsortedFrom, count) : count;
+    streamoff lo = 0, hi = sortedEnd;
+    while (lo < hi) {
+        streamoff mid = lo + (hi - lo) / 2;
+        int32_t midDay = 0;
+        reader.file.seekg(logHeaderBytes + mid * (streamoff)sizeof(LogRecord));
+        reader.file.read((char*)&midDay, sizeof(midDay));
+        if (midDay < day) lo = mid + 1;
+        else hi = mid;
+    }
+    reader.file.clear();
+    reader.file.seekg(logHeaderBytes + lo * (streamoff)sizeof(LogRecord));
+    for (streamoff i = lo; i < sortedEnd && reader.file.read((char*)&r, sizeof(r)) && r.day == day; ++i) {
+        records.push_back(r);
+    }
+
+    // Then everything appended out of order since the last compaction
+    if (sortedEnd < count) {
+        reader.file.clear();
+        reader.file.seekg(logHeaderBytes + sortedEnd * (streamoff)sizeof(LogRecord));
+        reader.batch.clear();
+        reader.next = 0;
+        while (readLogRecord(reader, r)) {
+            if (r.day == day) records.push_back(r);
+        }
+    }
+    return true;
+}
+
+bool foldLogCorrections(vector<LogRecord>& records, vector<uint32_t>* ordinals) {
+    bool hasCorrections = false;
+    for (const LogRecord& r : records) hasCorrections |= (r.flags != 0);
+    if (!hasCorrections) {
+        if (ordinals) {
+            unordered_map<int32_t, uint32_t> next;
+            ordinals->clear();
+            for (const LogRecord& r : records) ordinals->push_back(next[r.day]++);
+        }
+        return false;
+    }
+
+    // Entries keep their slot; a tombstone empties the slot of the entry it
+    // cancels and a replacement right after it fills that slot again
+    vector<LogRecord> live;
+    vector<uint32_t> liveOrdinals;
+    vector<bool> alive;
+    unordered_map<int32_t, uint32_t> next;            // next ordinal per day
+    unordered_map<uint64_t, size_t> slotOf;           // (day, ordinal) -> slot
+    size_t lastCancelled = SIZE_MAX;
+    for (const LogRecord& r : records) {
+        if (r.flags & LOG_FLAG_TOMBSTONE) {
+            auto it = slotOf.find(((uint64_t)(uint32_t)r.day << 32) | r.foodId);
+            lastCancelled = SIZE_MAX;
+            if (it != slotOf.end() && alive[it->second]) {
+                alive[it->second] = false;
+                lastCancelled = it->second;
+            }
+            continue;
+        }
+        uint32_t ordinal = next[r.day]++;
+        LogRecord entry = r;
+        entry.flags = 0;
+        size_t slot = live.size();
+        if ((r.flags & LOG_FLAG_REPLACEMENT) && lastCancelled != SIZE_MAX) {
+            slot = lastCancelled;
+            live[slot] = entry;
+            liveOrdinals[slot] = ordinal;
+            alive[slot] = true;
+        } else {
+            live.push_back(entry);
+            liveOrdinals.push_back(ordinal);
+            alive.push_back(true);
+        }
+        slotOf[((uint64_t)(uint32_t)r.day << 32) | ordinal] = slot;
+        lastCancelled = SIZE_MAX;
+    }
+
+    records.clear();
+    if (ordinals) ordinals->clear();
+    for (size_t i = 0; i < live.size(); ++i) {
+        if (!alive[i]) continue;
+        records.push_back(live[i]);
+        if (ordinals) ordinals->push_back(liveOrdinals[i]);
+    }
+    return true;
+}
+
+void readLogEntries(const string& username, int day, vector<LogEntry>& entries) {
+    vector<LogRecord> records;
+    vector<uint32_t> ordinals;
+    readLogDay(username, day, records);
+    foldLogCorrections(records, &ordinals);
+    for (size_t i = 0; i < records.size(); ++i) {
+        LogEntry entry;
+        entry.ordinal = ordinals[i];
+        entry.record = records[i];
+        entries.push_back(entry);
+    }
+}
+
+DayTotals getDayTotals(const string& username, int day) {
+    DayTotals totals;
+    vector<LogRecord> records;
+    readLogDay(username, day, records);
+    sumLogRecords(records.data(), records.size(), totals);
+    return totals;
+}
+
+// --- Corrections ---
+
+static LogRecord tombstoneFor(const LogEntry& entry) {
+    LogRecord t = entry.record;
+    t.foodId = entry.ordinal;
+    t.foodRev = 0;
+    t.flags = LOG_FLAG_TOMBSTONE;
+    t.grams = -t.grams;
+    t.calories = -t.calories;
+    t.protein = -t.protein;
+    t.carbs = -t.carbs;
+    t.fat = -t.fat;
+    return t;
+}
+
+static bool sameEntry(const LogRecord& a, const LogRecord& b) {
+    return a.day == b.day && a.foodId == b.foodId && a.foodRev == b.foodRev && a.mealType == b.mealType &&
+           a.grams == b.grams && a.calories == b.calories && a.protein == b.protein && a.carbs == b.carbs &&
+           a.fat == b.fat;
+}
+
+// The entry as the log holds it now. Another session may have compacted the
+// log since entry was read, which renumbers the day's entries, or corrected
+// the entry itself: the ordinal is taken from a live entry with the same food
+// and amounts, preferably the one still at entry.ordinal. False if none is left.
+static bool findCurrentEntry(const string& username, const LogEntry& entry, LogEntry& current) {
+    vector<LogEntry> entries;
+    readLogEntries(username, entry.record.day, entries);
+    const LogEntry* match = nullptr;
+    for (const LogEntry& e : entries) {
+        if (sameEntry(e.record, entry.record) && (!match || e.ordinal == entry.ordinal)) match = &e;
+    }
+    if (!match) return false;
+    current = *match;
+    return true;
+}
+
+// Both hold the user's exclusive lock from the lookup to the write, so no
+// compaction renumbers the day in between.
+bool deleteLogEntry(const string& username, const LogEntry& entry) {
+    FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    LogEntry current;
+    if (!findCurrentEntry(username, entry, current)) return false;
+    return logRecords(username, vector<LogRecord>(1, tombstoneFor(current)));
+}
+
+bool replaceLogEntry(const string& username, const LogEntry& entry, const LogRecord& replacement) {
+    FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    LogEntry current;
+    if (!findCurrentEntry(username, entry, current)) return false;
+    vector<LogRecord> records(1, tombstoneFor(current));
+    records.push_back(replacement);
+    records.back().day = current.record.day;
+    records.back().flags = LOG_FLAG_REPLACEMENT;
+    return logRecords(username, records);
+}
+
+// --- Text export ---
+
+void exportLogAsText(const string& username, ostream& out) {
+    out << fixed << setprecision(1);
+    int currentDay = NO_DAY;
+    for (const LogSegment& seg : getLogSegments(username)) {
+        // Corrections are folded per segment, in the order compaction would leave it
+        vector<LogRecord> records;
+        readSegment(logSegmentFileName(username, seg.month), records, &seg);
+        foldLogCorrections(records);
+        stable_sort(records.begin(), records.end(), recordOrder);
+
+        for (const LogRecord& r : records) {
+            if (r.day != currentDay) {
+                if (currentDay != NO_DAY) out << "END_DAILY_LOG\n\n";
+                out << "DAILY_LOG\n" << "Date: " << dayNumberToDate(r.day) << "\n";
+                currentDay = r.day;
+            }
+            FoodItem food;
+            FoodRef ref;
+            ref.id = r.foodId;
+            ref.rev = r.foodRev;
+            string name = resolveFood(username, ref, food) ? string(food.name()) : "Unknown food";
+
+            out << "Type: " << mealTypeName(r.mealType) << "\n"
+                << name << " | " << fromFixed(r.calories) << " | " << fromFixed(r.protein) << " | "
+                << fromFixed(r.carbs) << " | " << fromFixed(r.fat) << " | " << fromFixed(r.grams) << "\n";
+        }
+    }
+    if (currentDay != NO_DAY) out << "END_DAILY_LOG\n";
+    out.unsetf(ios::fixed);
+}
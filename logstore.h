@@ -0,0 +1,188 @@
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include "models.h"
+#include "foodids.h"
+#include "checksum.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+// Binary food log, split into one segment file per calendar month
+// (log_YYYY-MM.dat in the user's directory, userdirs.h) and listed in
+// log_manifest.txt.
+// Each segment is an 8-byte header ("NLOG" + format version) followed by
+// LogRecord structs. Records are stored in the machine's native byte order
+// (little-endian on all supported targets).
+//
+// Only the current month's segment is written to. Compaction sorts each open
+// segment by day and meal and seals past months: their files are re-encoded
+// column-wise (format version 3, see logstore.cpp), made read-only, and the
+// manifest records their day range, so range reads can skip them.
+//
+// Checksums (CRC32C, checksum.h): each packed block carries one and is checked
+// when it is decoded. An open segment cannot carry one, as sessions append to
+// it side by side; instead compaction notes in the manifest the checksum of
+// the records it leaves, and readers that start at the top of the segment
+// check them before handing out a record. Records appended since are checked
+// at the next compaction.
+//
+// Sessions of the same user may write at once (filelock.h): appends hold the
+// user's shared lock, while manifest changes and compaction hold the exclusive
+// one. The cached manifest is reloaded when another session has saved it.
+//
+// Entries are corrected with appended records (see LOG_FLAG_TOMBSTONE in
+// models.h): an edit or delete is one small write, and compaction folds the
+// corrections into the segment later.
+
+// Fixed-point helpers (tenths, see LogRecord)
+int32_t toFixed(double value);
+double fromFixed(int64_t value);
+
+// Meal type <-> the names used in the text format ("Breakfast", ...)
+std::string mealTypeName(uint8_t mealType);
+MealType parseMealType(const std::string& name);
+
+// One manifest entry.
+struct LogSegment {
+    std::string month;      // "YYYY-MM"
+    bool sealed = false;
+    uint32_t records = 0;   // only known for sealed segments
+    int firstDay = 0;       // day range covered (whole month while active)
+    int lastDay = 0;
+    int32_t unsortedFrom = -1;  // active only: first record appended out of day order
+    uint32_t checkedRecords = 0;    // active only: records covered by checksum, from the top
+    uint32_t checksum = 0;          // CRC32C of those records, as of the last compaction
+};
+
+// Month key ("YYYY-MM") of a day number, and the segment file for a month.
+std::string monthOfDay(int day);
+std::string logSegmentFileName(const std::string& username, const std::string& month);
+
+// Makes sure the manifest exists. On first use the older single-file binary log
+// (or, failing that, the DAILY_LOG blocks of the text data file) is split into
+// monthly segments once; the old files are left untouched.
+void ensureLogMigrated(const std::string& username);
+
+// The user's segments, oldest month first.
+const std::vector<LogSegment>& getLogSegments(const std::string& username);
+
+// Counts the changes of the user's cached manifest in this session (saved
+// here, or reloaded after another session saved it). Compaction always changes
+// it, so while it stays the same, records keep their positions in file order.
+uint64_t logManifestGeneration(const std::string& username);
+
+// Reads the manifest directly, without the session cache and without
+// migrating: safe to call from several threads at once (batch jobs). Returns
+// false if the user has no manifest yet.
+bool readLogManifest(const std::string& username, std::vector<LogSegment>& segments);
+
+// Streams records out of a log file in fixed-size batches, so memory use does
+// not depend on the length of the history. Packed segments are decoded one
+// block per batch.
+struct LogReader {
+    std::ifstream file;
+    std::string filename;
+    std::vector<LogRecord> batch;
+    size_t next = 0;
+    uint32_t version = 0;
+    bool packed = false;
+    std::string block;      // raw bytes of the current packed block
+    std::string damage;     // what a failed check found; reading stopped there
+};
+
+// Opens a segment. Given its manifest entry, the records the entry has a
+// checksum for are checked first, and a mismatch fails the open. Damage is
+// reported once on stderr (reportChecksumMismatch).
+bool openLogReader(LogReader& reader, const std::string& filename, const LogSegment* segment = nullptr);
+bool readLogRecord(LogReader& reader, LogRecord& out);
+
+// Reads a segment end to end and checks it against its checksums and its
+// manifest entry, without reporting on stderr. False if it is damaged.
+bool verifyLogSegment(const std::string& filename, const LogSegment& segment, FileCheck& check);
+
+// Appends the records of a segment from position from (in file order) up to
+// its last complete record, and returns the position after them. An open
+// segment is read from there on; a packed one is decoded and the first from
+// skipped. Records are checked against the manifest entry only when from is 0.
+uint64_t readLogTail(const std::string& username, const LogSegment& segment, uint64_t from,
+                     std::vector<LogRecord>& records);
+
+// Appends records with a single write (creating the file if needed), through
+// appendToFile (filelock.h) so concurrent sessions cannot overwrite each other.
+// endOffset, if given, receives the file size just after this write, i.e.
+// where these records end even if other sessions appended at the same time.
+bool appendLogRecords(const std::string& filename, const std::vector<LogRecord>& records,
+                      std::streamoff* endOffset = nullptr);
+
+// Builds the record for grams of a food revision (nutrients scaled from the
+// per-serving definition and rounded to fixed point).
+LogRecord makeLogRecord(FoodRef ref, const FoodItem& food, double grams, MealType meal, int day);
+
+// Appends a batch of records with one write per month touched (one write for a
+// batch logged today), then updates the usage table and the trends once for
+// the whole batch. (The reports pick new records up when queried.)
+bool logRecords(const std::string& username, const std::vector<LogRecord>& records);
+
+// Logs a food for today: registers its ID and writes the record via logRecords.
+// Returns false if the log could not be written.
+bool logFood(const std::string& username, const FoodItem& food, double grams, MealType meal);
+
+// Adds the amounts of n records to the totals (plain integer adds, no rounding).
+// A tombstone counts as minus one entry.
+void sumLogRecords(const LogRecord* records, size_t n, DayTotals& totals);
+
+// Calls visit for every record with firstDay <= day <= lastDay, in file order.
+// Segments outside the range are not opened; damaged ones are skipped.
+void scanLog(const std::string& username, int firstDay, int lastDay,
+             const std::function<void(const LogRecord&)>& visit);
+
+// One live entry of a day. ordinal is the entry's position among the day's
+// entries (records that are not tombstones) in file order; with the day it
+// identifies the entry until the next compaction, which may renumber them.
+struct LogEntry {
+    uint32_t ordinal = 0;
+    LogRecord record;
+};
+
+// Appends the records of one day, corrections included, in file order. Reads
+// only that day's run of its month's segment (binary search) plus any records
+// appended out of day order since the last compaction. In an open segment that
+// run is not checked against the manifest's checksum, which covers the whole
+// compacted part; packed blocks are checked as usual.
+bool readLogDay(const std::string& username, int day, std::vector<LogRecord>& records);
+
+// Applies the tombstones and replacements among records (in file order) and
+// removes them, leaving the live entries. ordinals, if given, receives each
+// remaining entry's ordinal. Returns true if there was anything to fold.
+bool foldLogCorrections(std::vector<LogRecord>& records, std::vector<uint32_t>* ordinals = nullptr);
+
+// The live entries of a day, in the order they were logged.
+void readLogEntries(const std::string& username, int day, std::vector<LogEntry>& entries);
+
+// Totals for one day (reads only that day's records, see readLogDay).
+DayTotals getDayTotals(const std::string& username, int day);
+
+// Cancels an entry (one tombstone record), or cancels it and writes its new
+// values in its place (tombstone plus replacement, one write). The day totals
+// behind reports and trends are adjusted by the same records. The entry is
+// looked up again by its food and amounts first, as another session may have
+// compacted the log since it was read; returns false if it is no longer there
+// (deleted or edited meanwhile) or the write failed.
+bool deleteLogEntry(const std::string& username, const LogEntry& entry);
+bool replaceLogEntry(const std::string& username, const LogEntry& entry, const LogRecord& replacement);
+
+// Folds corrections into each open segment, brings it into (day, meal) order,
+// merging entries of the same day that were logged apart, and seals segments
+// of past months. Updates the checksums of open segments, cuts off a record
+// left half written, and repacks segments sealed before blocks had checksums.
+// Damaged segments are left alone.
+void compactLog(const std::string& username);
+
+// Writes the whole log as DAILY_LOG text blocks in the original format:
+// "name | cal | protein | carbs | fat | grams" under "Date:" and "Type:" lines.
+void exportLogAsText(const std::string& username, std::ostream& out);
+
+#endif
@@ -4,6 +4,18 @@
 #include "profile.h"
 #include "food.h"
 #include "recommendations.h"
+#include "catalog.h"
+#include "logstore.h"
+#include "reports.h"
+#include "trends.h"
+#include "recipes.h"
+#include "targets.h"
+#include "projection.h"
+#include "analytics.h"
+#include "storage.h"
+#include "lockstress.h"
+#include "scrub.h"
+#include "userdirs.h"
 #include "utils.h"
 
 using namespace std;
@@ -27,7 +39,7 @@ void userDashboardMenu()
      << "║ 4️⃣  View Today's Consumption               🍽                                 ║\n"
      << "║ 5️⃣  Add Custom Food                        🥘                                 ║\n"
      << "║ 6️⃣  Get Meal Recommendations               🍱                                 ║\n"
-     << "║ 7️⃣  End Day & View Summary                 📅                                 ║\n"
+     << "║ 7️⃣  Summaries & History Reports            📅                                 ║\n"
      << "║ 8️⃣  Update Weight & Recalculate Targets    ⚖️                                 ║\n"
      << "║ 9️⃣  Logout                                 🚪                                 ║\n"
      << "╚═════════════════════════════════════════════════════════════════════════════╝\n\n"
@@ -35,22 +47,103 @@ void userDashboardMenu()
 }
 
 // Application Entry Point.
-// 1. Sets up the console environment.
+// "--migrate-layout" moves per-user files from the old flat layout into data/ (userdirs.h) and exits;
+// every other start does this once on its own.
+// "--export-trends" writes the coaching trend export (trends.h) as CSV to stdout and exits.
+// "--recompute-targets" recomputes every user's targets in one batch (targets.h) and exits.
+// "--project-weights" updates every user's weight projection (projection.h), writes it as CSV and exits.
+// "--population-report [days]" prints intake, adherence and food statistics over all users (analytics.h) and exits.
+// "--storage-benchmark [users] [days]" times the storage engines on the same workload (storage.h) and exits.
+// "--scrub [threads]" checks every stored file against its checksums (scrub.h) and exits.
+// "--lock-stress [sessions] [entries]" runs concurrent sessions against the file locks (lockstress.h) and exits;
+// "--lock-stress-worker" is one of its sessions.
+// Otherwise:
+// 1. Sets up the console environment and starts the foods.txt reload watcher.
 // 2. Enters the main application loop.
-// 3. Handles User Authentication (Login/Register).
+// 3. Handles User Authentication (Login/Register) and compacts the user's food log.
 // 4. If authenticated, enters the Dashboard Loop where users can access features.
 // 5. Handles Logout to return to the main authentication screen.
-int main() {
+// 6. On Exit, stops the reload watcher before returning.
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--migrate-layout") {
+        migrateFlatLayout(&cout);
+        return 0;
+    }
+    ensureDataLayout();
+
+    if (argc > 1 && string(argv[1]) == "--export-trends") {
+        exportCoachingTrends(cout);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--recompute-targets") {
+        recomputeAllTargets(cout);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--project-weights") {
+        projectAllUsers(cout);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--population-report") {
+        int days = 30;
+        if (argc > 2) {
+            try { days = stoi(argv[2]); } catch (...) { days = 30; }
+        }
+        runPopulationReport(cout, days);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--storage-benchmark") {
+        int users = 200, days = 60;
+        if (argc > 2) {
+            try { users = stoi(argv[2]); } catch (...) { users = 200; }
+        }
+        if (argc > 3) {
+            try { days = stoi(argv[3]); } catch (...) { days = 60; }
+        }
+        runStorageBenchmark(cout, users, days);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--scrub") {
+        int threads = 0;
+        if (argc > 2) {
+            try { threads = stoi(argv[2]); } catch (...) { threads = 0; }
+        }
+        return runScrub(cout, threads) ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "--lock-stress") {
+        int sessions = 8, entries = 200;
+        if (argc > 2) {
+            try { sessions = stoi(argv[2]); } catch (...) { sessions = 8; }
+        }
+        if (argc > 3) {
+            try { entries = stoi(argv[3]); } catch (...) { entries = 200; }
+        }
+        return runLockStress(cout, argv[0], sessions, entries) ? 0 : 1;
+    }
+    if (argc > 4 && string(argv[1]) == "--lock-stress-worker") {
+        try {
+            runLockStressWorker(argv[2], stoi(argv[3]), stoi(argv[4]));
+        } catch (...) {
+            return 1;
+        }
+        return 0;
+    }
+
     setupConsole();
+    startCatalogWatcher();
     
     while(true) {
         
         UserProfile currentUser;
         bool loggedIn = false;
+        bool quit = false;
         
-        loggedIn = authentication(currentUser);
+        loggedIn = authentication(currentUser, quit);
+        if (quit) break;
         
         if (loggedIn) {
+            compactLog(currentUser.username);
+            loadRecipes(currentUser.username);
+
             // Dashboard Loop
             while(true) {
                 userDashboardMenu();
@@ -74,8 +167,7 @@ int main() {
                         displayProfile(currentUser);
                         break;
                     case 2:
-                        printHeader("DAILY TARGETS");
-                        displayNutritionTargets(currentUser);
+                        runTargetSettings(currentUser);
                         break;
                     case 3:
                         runAddFood(currentUser);
@@ -90,13 +182,11 @@ int main() {
                         runMealRecommendations(currentUser);
                         break;
                     case 7:
-                        runEndDaySummary(currentUser);
+                        runHistoryReports(currentUser);
                         break;
-                    case 8: {
-                        string filename = "user_" + currentUser.username + "_data.txt";
-                        updateWeightAndTargets(filename, currentUser);
+                    case 8:
+                        updateWeightAndTargets(currentUser);
                         break;
-                    }
                     case 9:
                         loggedIn = false;
                         cout << "Logging out...\n";
@@ -112,5 +202,6 @@ int main() {
             }
         }
     }
+    stopCatalogWatcher();
     return 0;
 }
\ No newline at end of file
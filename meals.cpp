@@ -0,0 +1,216 @@
+#include "meals.h"
+#include "logstore.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <map>
+
+using namespace std;
+
+static map<string, vector<MealTemplate>> templateCache;
+
+static string mealsFileName(const string& username) {
+    return userFilePath(username, "meals.txt");
+}
+
+// --- Persistence ---
+// MEAL_TEMPLATE
+// Name: My usual breakfast
+// Meal: Breakfast
+// Totals: calories | protein | carbs | fat      (fixed-point tenths)
+// @<id>[:<rev>] | <grams>                       (one line per item)
+// END_MEAL_TEMPLATE
+
+static void loadTemplates(const string& username, vector<MealTemplate>& templates) {
+    ifstream file(mealsFileName(username));
+    string line;
+    MealTemplate current;
+    bool inBlock = false;
+    while (getline(file, line)) {
+        string t = trim(line);
+        if (t == "MEAL_TEMPLATE") { current = MealTemplate(); inBlock = true; continue; }
+        if (!inBlock) continue;
+        if (t == "END_MEAL_TEMPLATE") {
+            if (!current.name.empty() && !current.items.empty()) templates.push_back(current);
+            inBlock = false;
+        } else if (t.rfind("Name:", 0) == 0) {
+            current.name = trim(t.substr(5));
+        } else if (t.rfind("Meal:", 0) == 0) {
+            current.meal = parseMealType(t.substr(5));
+        } else if (t.rfind("Totals:", 0) == 0) {
+            stringstream ss(t.substr(7));
+            char bar;
+            ss >> current.totals.calories >> bar >> current.totals.protein >> bar
+               >> current.totals.carbs >> bar >> current.totals.fat;
+        } else {
+            LoggedFood food;
+            if (!parseLogEntryLine(username, t, food) || food.ref.id == 0) continue;
+            MealTemplateItem item;
+            item.ref = food.ref;
+            item.grams = food.grams;
+            current.items.push_back(item);
+            current.totals.entries++;
+        }
+    }
+}
+
+static void saveTemplates(const string& username, const vector<MealTemplate>& templates) {
+    ensureUserDir(username);
+    ofstream out(mealsFileName(username), ios::trunc);
+    for (const MealTemplate& tmpl : templates) {
+        out << "MEAL_TEMPLATE\n"
+            << "Name: " << tmpl.name << "\n"
+            << "Meal: " << mealTypeName(tmpl.meal) << "\n"
+            << "Totals: " << tmpl.totals.calories << " | " << tmpl.totals.protein << " | "
+            << tmpl.totals.carbs << " | " << tmpl.totals.fat << "\n";
+        for (const MealTemplateItem& item : tmpl.items) out << formatLogEntryLine(item.ref, item.grams) << "\n";
+        out << "END_MEAL_TEMPLATE\n\n";
+    }
+}
+
+static vector<MealTemplate>& templatesFor(const string& username) {
+    auto it = templateCache.find(username);
+    if (it != templateCache.end()) return it->second;
+    vector<MealTemplate>& templates = templateCache[username];
+    loadTemplates(username, templates);
+    return templates;
+}
+
+// Live entries of one meal on one day (corrections applied), in log order.
+static void readMealRecords(const string& username, int day, MealType meal, vector<LogRecord>& out) {
+    vector<LogEntry> entries;
+    readLogEntries(username, day, entries);
+    for (const LogEntry& e : entries) {
+        if (e.record.mealType == meal) out.push_back(e.record);
+    }
+}
+
+// --- Public API ---
+
+const vector<MealTemplate>& getMealTemplates(const string& username) {
+    return templatesFor(username);
+}
+
+bool saveMealTemplate(const string& username, const string& name, int day, MealType meal) {
+    vector<LogRecord> records;
+    readMealRecords(username, day, meal, records);
+    if (records.empty() || trim(name).empty()) return false;
+
+    MealTemplate tmpl;
+    tmpl.name = trim(name);
+    tmpl.meal = meal;
+    for (const LogRecord& r : records) {
+        MealTemplateItem item;
+        item.ref.id = r.foodId;
+        item.ref.rev = r.foodRev;
+        item.grams = fromFixed(r.grams);
+        tmpl.items.push_back(item);
+    }
+    sumLogRecords(records.data(), records.size(), tmpl.totals);
+
+    vector<MealTemplate>& templates = templatesFor(username);
+    bool replaced = false;
+    for (MealTemplate& existing : templates) {
+        if (toLower(existing.name) == toLower(tmpl.name)) {
+            existing = tmpl;
+            replaced = true;
+        }
+    }
+    if (!replaced) templates.push_back(tmpl);
+    saveTemplates(username, templates);
+    return true;
+}
+
+bool logMealTemplate(const string& username, const MealTemplate& tmpl, MealType meal) {
+    int today = dateToDayNumber(getTodayDate());
+    vector<LogRecord> records;
+    for (const MealTemplateItem& item : tmpl.items) {
+        FoodItem food;
+        if (!resolveFood(username, item.ref, food)) continue;
+        records.push_back(makeLogRecord(item.ref, food, item.grams, meal, today));
+    }
+    if (records.empty()) return false;
+    return logRecords(username, records);
+}
+
+int repeatMeal(const string& username, int fromDay, MealType meal) {
+    vector<LogRecord> records;
+    readMealRecords(username, fromDay, meal, records);
+    int today = dateToDayNumber(getTodayDate());
+    for (LogRecord& r : records) r.day = today;
+    if (!logRecords(username, records)) return -1;
+    return (int)records.size();
+}
+
+// --- Menu ---
+
+static void printTemplateLine(size_t index, const MealTemplate& tmpl) {
+    cout << index << ". " << tmpl.name << " (" << tmpl.items.size() << " item"
+         << (tmpl.items.size() == 1 ? "" : "s") << ", " << (int)round(fromFixed(tmpl.totals.calories))
+         << " kcal, " << (int)round(fromFixed(tmpl.totals.protein)) << "g P / "
+         << (int)round(fromFixed(tmpl.totals.carbs)) << "g C / "
+         << (int)round(fromFixed(tmpl.totals.fat)) << "g F)\n";
+}
+
+bool runMealShortcuts(const UserProfile& p, MealType meal) {
+    string mealName = mealTypeName(meal);
+    cout << "\n1. Search for a food\n"
+         << "2. Log a saved meal\n"
+         << "3. Repeat yesterday's " << mealName << "\n"
+         << "4. Save today's " << mealName << " as a saved meal\n"
+         << "Choice [Enter = 1] (or 'b' to go back): ";
+    string choice;
+    getline(cin, choice);
+    choice = trim(choice);
+    if (choice.empty() || choice == "1") return false;
+    if (checkForBack(choice)) return true;
+
+    int today = dateToDayNumber(getTodayDate());
+    if (choice == "2") {
+        const vector<MealTemplate>& templates = getMealTemplates(p.username);
+        if (templates.empty()) {
+            cout << "\nNo saved meals yet. Log a meal, then use option 4 to save it.\n";
+            pauseConsole();
+            return true;
+        }
+        cout << "\nSaved meals:\n";
+        for (size_t i = 0; i < templates.size(); ++i) printTemplateLine(i + 1, templates[i]);
+        cout << "Select (0 to cancel): ";
+        string sel;
+        getline(cin, sel);
+        int index = 0;
+        try { index = stoi(trim(sel)); } catch (...) { index = 0; }
+        if (index < 1 || index > (int)templates.size()) return true;
+
+        const MealTemplate& tmpl = templates[index - 1];
+        if (logMealTemplate(p.username, tmpl, meal)) {
+            cout << "\n✓ Logged \"" << tmpl.name << "\" to " << mealName << ": " << tmpl.items.size()
+                 << " items, " << fixed << setprecision(1) << fromFixed(tmpl.totals.calories) << " calories\n";
+            cout.unsetf(ios::fixed);
+        } else {
+            cout << "\nError writing to log file.\n";
+        }
+        pauseConsole();
+    } else if (choice == "3") {
+        int logged = repeatMeal(p.username, today - 1, meal);
+        if (logged < 0) cout << "\nError writing to log file.\n";
+        else if (logged == 0) cout << "\nNothing was logged for " << mealName << " yesterday.\n";
+        else cout << "\n✓ Repeated yesterday's " << mealName << " (" << logged << " items).\n";
+        pauseConsole();
+    } else if (choice == "4") {
+        cout << "Name for this meal (e.g. My usual " << toLower(mealName) << "): ";
+        string name;
+        getline(cin, name);
+        name = trim(name);
+        if (checkForBack(name) || name.empty()) return true;
+        if (saveMealTemplate(p.username, name, today, meal)) cout << "\n✓ Saved \"" << name << "\".\n";
+        else cout << "\nNothing was logged for " << mealName << " today.\n";
+        pauseConsole();
+    } else {
+        cout << "Invalid choice.\n";
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef MEALS_H
+#define MEALS_H
+
+#include "models.h"
+#include "foodids.h"
+#include <string>
+#include <vector>
+
+// Saved meals ("my usual breakfast") and repeating a meal from another day.
+//
+// Templates are stored in the user's meals.txt as MEAL_TEMPLATE blocks. Each
+// block keeps the food references with grams and the pre-computed totals, so
+// listing templates never resolves foods. Logging a template or repeating a
+// meal writes all of its entries with a single logRecords call.
+
+struct MealTemplateItem {
+    FoodRef ref;
+    double grams = 0.0;
+};
+
+struct MealTemplate {
+    std::string name;
+    MealType meal = MEAL_OTHER;            // meal it was saved from
+    std::vector<MealTemplateItem> items;
+    DayTotals totals;                      // fixed-point sums of the items
+};
+
+// The user's templates in the order they were saved.
+const std::vector<MealTemplate>& getMealTemplates(const std::string& username);
+
+// Saves the entries logged for a meal on a day as a template (replacing a
+// template with the same name). Returns false if that meal has no entries.
+bool saveMealTemplate(const std::string& username, const std::string& name, int day, MealType meal);
+
+// Logs every item of a template for today under the given meal.
+bool logMealTemplate(const std::string& username, const MealTemplate& tmpl, MealType meal);
+
+// Copies the entries of a meal on fromDay into today's log (same foods,
+// revisions and amounts). Returns the number of entries logged, -1 on error.
+int repeatMeal(const std::string& username, int fromDay, MealType meal);
+
+// Menu shown after choosing the meal in "Add Food": log a saved meal, repeat
+// yesterday's meal or save today's meal. Returns false if the user chose to
+// search for a single food instead.
+bool runMealShortcuts(const UserProfile& p, MealType meal);
+
+#endif
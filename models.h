@@ -3,60 +3,142 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <string_view>
+#include "strpool.h"
 using namespace std;
+
+// Gender as stored in the profile.
+enum Gender : uint8_t {
+    GENDER_FEMALE = 0,
+    GENDER_MALE = 1,
+    GENDERS = 2
+};
+
+const char* const GENDER_NAMES[GENDERS] = { "Female", "Male" };
+
+// Activity levels in the order of the registration menu.
+enum ActivityLevel : uint8_t {
+    ACTIVITY_SEDENTARY = 0,
+    ACTIVITY_LIGHT = 1,
+    ACTIVITY_MODERATE = 2,
+    ACTIVITY_VERY = 3,
+    ACTIVITY_LEVELS = 4
+};
+
+const char* const ACTIVITY_LEVEL_NAMES[ACTIVITY_LEVELS] = { "Sedentary", "Lightly Active", "Moderately Active", "Very Active" };
+
+// Formula used for the basal metabolic rate (see targets.h).
+enum BmrFormula : uint8_t {
+    BMR_MIFFLIN_ST_JEOR = 0,
+    BMR_HARRIS_BENEDICT = 1,
+    BMR_KATCH_MCARDLE = 2,     // needs the body fat percentage
+    BMR_FORMULAS = 3
+};
+
+// How the calorie target is split into macros (see MACRO_SPLITS in targets.h).
+enum MacroStrategy : uint8_t {
+    MACRO_BALANCED = 0,
+    MACRO_HIGH_PROTEIN = 1,
+    MACRO_LOW_FAT = 2,
+    MACRO_KETO = 3,
+    MACRO_STRATEGIES = 4
+};
+
+// ID of a user without a record in the profile store (profilestore.h).
+const uint32_t NO_USER_ID = 0xFFFFFFFF;
+
 // Structure for User Profile
 // Structure for User Profile
 // Stores all personal information and calculated nutritional targets.
+// Stored as a fixed-size ProfileRecord (profilestore.h); the password is only
+// checked at login and never kept here.
 struct UserProfile {
-    string username;           // Used for linking to file names (e.g., user_USERNAME_data.txt)
-    string fullName;
-    string password;
-    int age = 0;
-    string gender;             // "Male" or "Female"
-    int height_cm = 0;
-    double weight_kg = 0.0;
-    string activityLevel;      // e.g., "Sedentary", "Lightly Active"
+    uint32_t userId = NO_USER_ID;  // record index in the profile store
+    string username;           // Used for linking to file names (e.g., data/ab/cd/USERNAME/log_manifest.txt)
+    uint32_t fullNameId = 0;   // interned full name (strpool.h)
+    uint16_t age = 0;
+    uint16_t height_cm = 0;
+    float weight_kg = 0.0f;
+    float bodyFatPercent = 0.0f;                  // 0 = unknown
+    Gender gender = GENDER_FEMALE;
+    ActivityLevel activityLevel = ACTIVITY_SEDENTARY;
+    BmrFormula bmrFormula = BMR_MIFFLIN_ST_JEOR;
+    MacroStrategy macroStrategy = MACRO_BALANCED;
     
     // Calculated Targets (runtime only, re-calculated on load)
     double dailyCaloriesTarget = 0.0;
     double targetProtein_g = 0.0;
     double targetCarbs_g = 0.0;
     double targetFat_g = 0.0;
+
+    std::string_view fullName() const { return pooledString(fullNameId); }
 };
 
 // Structure for Food Item
 // Structure for Food Item
 // Represents a single food entry from the database (foods.txt) or custom foods.
+// Strings are interned in the string pool (strpool.h), so the struct is small and
+// trivially copyable: copying a FoodItem never allocates.
 struct FoodItem {
-    string name;
-    double calories = 0.0;
-    double protein = 0.0;
-    double carbs = 0.0;
-    double fat = 0.0;
-    double servingSize = 100.0; // Standard reference serving size in grams
+    uint32_t nameId = 0;        // interned display name
+    uint32_t keyId = 0;         // interned normalized name (lower-case, single spaces) for lookups
+    uint32_t unitId = 0;        // interned unit of the serving size ("g", "ml", "pc")
+    float calories = 0.0f;
+    float protein = 0.0f;
+    float carbs = 0.0f;
+    float fat = 0.0f;
+    float servingSize = 100.0f; // Standard reference serving size
+    bool isCustom = false;      // true for foods from the user's custom foods file
+
+    std::string_view name() const { return pooledString(nameId); }
+    std::string_view key() const { return pooledString(keyId); }
+    std::string_view unit() const { return unitId ? pooledString(unitId) : std::string_view("g"); }
+};
+
+// Meal a log entry belongs to (stored as one byte in LogRecord).
+enum MealType : uint8_t {
+    MEAL_OTHER = 0,
+    MEAL_BREAKFAST = 1,
+    MEAL_LUNCH = 2,
+    MEAL_DINNER = 3,
+    MEAL_SNACK = 4,
+    MEAL_AUTO_ADDED = 5     // added from Meal Recommendations
 };
 
+// Structure for one logged food (fixed-size binary record, 32 bytes)
+// Amounts are fixed-point tenths: grams/protein/carbs/fat in decigrams and
+// calories in tenths of a kcal, so sums over any number of entries are exact.
+struct LogRecord {
+    int32_t day = 0;         // days since 1970-01-01 (see dateToDayNumber)
+    uint32_t foodId = 0;     // registered food ID (see foodids.h)
+    uint16_t foodRev = 0;    // nutrient revision of that food
+    uint8_t mealType = MEAL_OTHER;
+    uint8_t flags = 0;       // LOG_FLAG_* (0 for an ordinary entry)
+    int32_t grams = 0;
+    int32_t calories = 0;
+    int32_t protein = 0;
+    int32_t carbs = 0;
+    int32_t fat = 0;
+};
+
+// LogRecord.flags. Corrections are appended, never written in place:
+// a tombstone cancels an earlier entry of its day; its foodId holds that
+// entry's ordinal (see LogEntry in logstore.h) and its amounts are the entry's
+// amounts negated, so plain sums over the records stay correct.
+// A replacement record directly after a tombstone takes the cancelled
+// entry's place in the day.
+const uint8_t LOG_FLAG_TOMBSTONE = 0x01;
+const uint8_t LOG_FLAG_REPLACEMENT = 0x02;
+
 // Structure to track daily totals
-// Structure to track daily totals and individual log entries.
-// Used primarily during runtime aggregation of daily consumption.
-struct DailyLog {
-    string date;
-    vector<pair<FoodItem, double>> consumedMeals; // List of meals: {FoodItem, GramsConfirmed}
-    
-    // Individual entry fields used when parsing a log file line-by-line:
-    string mealType;      // "Breakfast", "Lunch", etc.
-    string foodName;
-    double grams;
-    double calories;
-    double protein;
-    double carbs;
-    double fat;
-    
-    // Aggregated daily totals:
-    double totalCalories = 0.0;
-    double totalProtein = 0.0;
-    double totalCarbs = 0.0;
-    double totalFat = 0.0;
+// Exact fixed-point sums of LogRecord amounts (same units as LogRecord).
+struct DayTotals {
+    int64_t calories = 0;
+    int64_t protein = 0;
+    int64_t carbs = 0;
+    int64_t fat = 0;
+    int32_t entries = 0;
 };
 
 #endif
@@ -1,75 +1,78 @@
 #include "profile.h"
 #include "utils.h"     
 #include "models.h"
+#include "weight.h"
+#include "targets.h"
+#include "profilestore.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <cmath>
 #include <ctime>
 #include <iomanip>
-#include <cctype>       
-
-// Serializes core profile fields into the stream in "Key: Value" format.
-// Only writes the USER_PROFILE block, not detailed logs.
-static void writeProfileBlock(std::ostream& out, const UserProfile& p) {
-    out << "USER_PROFILE\n";
-    out << "Name: " << p.fullName << "\n";
-    out << "Age: " << p.age << "\n";
-    out << "Gender: " << p.gender << "\n";
-    out << "Height: " << p.height_cm << "\n";
-    out << "Weight: " << p.weight_kg << "\n";
-    out << "Activity_Level: " << p.activityLevel << "\n";
-    out << "Daily_Calorie_Target: " << static_cast<int>(p.dailyCaloriesTarget) << "\n";
-    out << "\n";
+#include <cctype>
+#include <functional>
+
+// Inputs of the target formulas for a profile.
+static TargetInputs targetInputs(const UserProfile& p) {
+    TargetInputs in;
+    in.weightKg = p.weight_kg;
+    in.heightCm = p.height_cm;
+    in.age = p.age;
+    in.male = maleFactor(p.gender);
+    in.bodyFatPercent = p.bodyFatPercent;
+    in.multiplier = ACTIVITY_MULTIPLIERS[p.activityLevel % ACTIVITY_LEVELS];
+    return in;
 }
 
-// Computes BMR (Basal Metabolic Rate) using the Mifflin-St Jeor formula.
-// Adjusts calculation based on gender (Male/Female).
+// Computes BMR (Basal Metabolic Rate) with the user's formula (Mifflin-St Jeor
+// unless another one was chosen, see targets.h).
 double calcBMR(const UserProfile& p) {
-    if (p.gender == "Male") {
-        return 10.0 * p.weight_kg + 6.25 * p.height_cm - 5.0 * p.age + 5.0;
-    } else {
-        return 10.0 * p.weight_kg + 6.25 * p.height_cm - 5.0 * p.age - 161.0;
+    TargetInputs in = targetInputs(p);
+    switch (p.bmrFormula) {
+        case BMR_HARRIS_BENEDICT: return bmrFor<BMR_HARRIS_BENEDICT>(in);
+        case BMR_KATCH_MCARDLE: return bmrFor<BMR_KATCH_MCARDLE>(in);
+        default: return bmrFor<BMR_MIFFLIN_ST_JEOR>(in);
     }
 }
 
 // Returns a multiplier to convert BMR to TDEE based on activity level.
-// Uses substring matching to handle variations in activity level strings.
-double activityMultiplier(const std::string& level) {
-    std::string l = level;
-    if (l.find("Sedentary") != std::string::npos) return 1.2;
-    if (l.find("Lightly") != std::string::npos) return 1.375;
-    if (l.find("Moderately") != std::string::npos) return 1.55;
-    if (l.find("Very") != std::string::npos) return 1.725;
-    return 1.2;
+double activityMultiplier(ActivityLevel level) {
+    return ACTIVITY_MULTIPLIERS[level % ACTIVITY_LEVELS];
 }
 
-// Computes daily calorie and macronutrient targets based on user stats.
-// Sets protein to 2g/kg, carbs to 55% of calories, and fat to 25% of calories.
+// Computes daily calorie and macronutrient targets with the user's BMR formula
+// and macro split (by default Mifflin-St Jeor, 2g/kg protein, 55% carbs and
+// 25% fat). Uses the same instantiation the batch engine runs for this policy.
 void calcMacroTargets(UserProfile& p) {
-    double bmr = calcBMR(p);
-    double tdee = bmr * activityMultiplier(p.activityLevel);
-    p.dailyCaloriesTarget = std::round(tdee);
-    p.targetProtein_g = std::round(p.weight_kg * 2.0);
-    p.targetCarbs_g = std::round((p.dailyCaloriesTarget * 0.55) / 4.0);
-    p.targetFat_g = std::round((p.dailyCaloriesTarget * 0.25) / 9.0);
+    MacroTargets t = targetRowFunction(p.bmrFormula, p.macroStrategy)(targetInputs(p));
+    p.dailyCaloriesTarget = t.calories;
+    p.targetProtein_g = t.protein;
+    p.targetCarbs_g = t.carbs;
+    p.targetFat_g = t.fat;
 }
 
 // Prints the calculated daily nutrition targets (Calories, Protein, Carbs, Fat).
 // Formats output with fixed widths for readability.
-void displayNutritionTargets(const UserProfile& p) {
+static void printNutritionTargets(const UserProfile& p) {
     printHeader("DAILY NUTRITION TARGETS");
     std::cout << left << setw(18) << "Calories:" << right << setw(6) << static_cast<int>(p.dailyCaloriesTarget) << " kcal\n";
     std::cout << left << setw(18) << "Protein:" << right << setw(6) << static_cast<int>(p.targetProtein_g) << " g\n";
     std::cout << left << setw(18) << "Carbohydrates:" << right << setw(6) << static_cast<int>(p.targetCarbs_g) << " g\n";
-    std::cout << left << setw(18) << "Fat:" << right << setw(6) << static_cast<int>(p.targetFat_g) << " g\n\n";
+    std::cout << left << setw(18) << "Fat:" << right << setw(6) << static_cast<int>(p.targetFat_g) << " g\n";
+    std::cout << left << setw(18) << "BMR formula:" << BMR_FORMULA_NAMES[p.bmrFormula % BMR_FORMULAS] << "\n";
+    std::cout << left << setw(18) << "Macro split:" << MACRO_SPLITS[p.macroStrategy % MACRO_STRATEGIES].name << "\n\n";
+}
+
+void displayNutritionTargets(const UserProfile& p) {
+    printNutritionTargets(p);
     pauseConsole();
 }
 
 // Prints all user profile details to the console if a profile is loaded.
 // Displays fields like Name, Age, Gender, Height, Weight, and Activity Level.
 void displayProfile(const UserProfile& p) {
-    if (p.fullName.empty()) {
+    if (p.userId == NO_USER_ID) {
         std::cout << "No profile loaded yet.\n";
         pauseConsole();
         return;
@@ -79,85 +82,67 @@ void displayProfile(const UserProfile& p) {
     const int labelWidth = 18;
     const int valueStartCol = 2; // single space after label
     std::cout << left << setw(labelWidth) << "Username:" << string(valueStartCol, ' ') << p.username << "\n";
-    std::cout << left << setw(labelWidth) << "Full Name:" << string(valueStartCol, ' ') << p.fullName << "\n";
+    std::cout << left << setw(labelWidth) << "Full Name:" << string(valueStartCol, ' ') << p.fullName() << "\n";
     std::cout << left << setw(labelWidth) << "Age:" << string(valueStartCol, ' ') << p.age << " years\n";
-    std::cout << left << setw(labelWidth) << "Gender:" << string(valueStartCol, ' ') << p.gender << "\n";
+    std::cout << left << setw(labelWidth) << "Gender:" << string(valueStartCol, ' ') << GENDER_NAMES[p.gender % GENDERS] << "\n";
     std::cout << left << setw(labelWidth) << "Height:" << string(valueStartCol, ' ') << p.height_cm << " cm\n";
     std::cout << left << setw(labelWidth) << "Weight:" << string(valueStartCol, ' ') << p.weight_kg << " kg\n";
-    std::cout << left << setw(labelWidth) << "Activity Level:" << string(valueStartCol, ' ') << p.activityLevel << "\n\n";
+    std::cout << left << setw(labelWidth) << "Activity Level:" << string(valueStartCol, ' ') << ACTIVITY_LEVEL_NAMES[p.activityLevel % ACTIVITY_LEVELS] << "\n\n";
 
     pauseConsole();
 }
 
-// Creates (or overwrites) the user's data file and saves the profile.
-// Called during registration to initialize the file.
-void createUserDataFile(const std::string& filename, const UserProfile& p) {
-    std::ofstream fout(filename);
-    if (!fout) {
-        std::cerr << "Error creating file: " << filename << "\n";
+// Saves a newly registered profile as a new record in the profile store.
+bool createUserProfile(UserProfile& p) {
+    if (!writeProfile(p)) {
+        std::cerr << "Error saving profile for " << p.username << "\n";
         pauseConsole();
-        return;
+        return false;
     }
-
-    writeProfileBlock(fout, p);
-    fout.close();
-    std::cout << "Profile saved to " << filename << "\n";
-    pauseConsole();
+    return true;
 }
 
-// Reads profile data from the user's file and populates the UserProfile struct.
-// Recalculates macro targets after loading the raw data.
-void loadProfileFromFile(const std::string& filename, UserProfile& p) {
-    std::ifstream fin(filename);
-    if (!fin) {
-        std::cerr << "Error opening file: " << filename << "\n";
+// Reads the user's record from the profile store (importing a profile that is
+// still only in the text data file) and recalculates the targets.
+bool loadUserProfile(const std::string& username, UserProfile& p) {
+    uint32_t id = findUserId(username);
+    if (id == NO_USER_ID || !readProfile(id, p)) {
+        std::cerr << "Error loading profile for " << username << "\n";
+        p.username = username;
         pauseConsole();
-        return;
+        return false;
     }
+    calcMacroTargets(p);
+    return true;
+}
 
-    // Infer username from filename pattern "user_<username>_data.txt"
-    // If filename matches, set p.username so other modules have it available.
-    size_t ustart = filename.find("user_");
-    size_t uend = filename.find("_data");
-    if (ustart != std::string::npos && uend != std::string::npos && uend > ustart + 5) {
-        p.username = filename.substr(ustart + 5, uend - (ustart + 5));
+// Prints the weight trend from the running statistics (see weight.h).
+static void displayWeightTrend(const WeightTrend& t) {
+    if (t.entries == 0) {
+        std::cout << "No weigh-ins recorded yet.\n";
+        return;
     }
-
-    std::string line;
-    bool inProfile = false;
-
-    while (std::getline(fin, line)) {
-        if (line == "USER_PROFILE") {
-            inProfile = true;
-            continue;
-        }
-        if (inProfile && line.empty()) break;
-
-        size_t colon = line.find(": ");
-        if (colon == std::string::npos) continue;
-
-        std::string key = line.substr(0, colon);
-        std::string val = line.substr(colon + 2);
-
-        if (key == "Name") p.fullName = val;
-        else if (key == "Age") p.age = std::stoi(val);
-        else if (key == "Gender") p.gender = val;
-        else if (key == "Height") p.height_cm = std::stod(val);
-        else if (key == "Weight") p.weight_kg = std::stoi(val);
-        else if (key == "Activity_Level") p.activityLevel = val;
-        else if (key == "Daily_Calorie_Target") p.dailyCaloriesTarget = std::stod(val);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << left << setw(18) << "Last weigh-in:" << t.latestKg << " kg (" << dayNumberToDate(t.lastDay) << ")\n";
+    std::cout << left << setw(18) << "Trend weight:" << t.smoothedKg << " kg\n";
+    if (t.hasSlope) {
+        std::cout << left << setw(18) << "Trend:" << std::showpos << std::setprecision(2) << t.slopeKgPerWeek
+                  << std::noshowpos << " kg/week\n";
+    } else {
+        std::cout << left << setw(18) << "Trend:" << "needs 3 weigh-ins over a week\n";
     }
-
-    fin.close();
-    calcMacroTargets(p);
+    std::cout << left << setw(18) << "Weigh-ins:" << t.entries << " since " << dayNumberToDate(t.firstDay) << "\n";
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
 }
 
-
-// Prompts the user to update their weight and recalculates nutrition targets.
-
-void updateWeightAndTargets(const std::string& filename, UserProfile& p) {
+// Records a weigh-in and shows the weight trend. Targets follow the smoothed
+// weight: they are recalculated (and the profile saved) only when it has
+// moved WEIGHT_TARGET_STEP_KG or more from the weight they were based on.
+void updateWeightAndTargets(UserProfile& p) {
     std::cout << "\n--- Update Weight ---\n";
-    std::cout << "Current weight: " << p.weight_kg << " kg\n";
+    displayWeightTrend(getWeightTrend(p.username));
+    std::cout << "Targets based on: " << p.weight_kg << " kg\n";
     std::cout << "Enter new weight (kg) or 'b' to back/cancel: ";
 
     std::string input;
@@ -187,23 +172,104 @@ void updateWeightAndTargets(const std::string& filename, UserProfile& p) {
         return;
     }
 
-    p.weight_kg = newWeight;
-    calcMacroTargets(p);
+    if (!recordWeight(p.username, newWeight, dateToDayNumber(getTodayDate()))) {
+        std::cerr << "Error writing weight history for " << p.username << "\n";
+        pauseConsole();
+        return;
+    }
+    WeightTrend trend = getWeightTrend(p.username);
+    std::cout << "\nWeight " << newWeight << " kg recorded.\n";
+    displayWeightTrend(trend);
 
-    std::cout << "Weight updated to " << newWeight << " kg.\n";
-    displayNutritionTargets(p);
+    if (std::fabs(trend.smoothedKg - p.weight_kg) < WEIGHT_TARGET_STEP_KG) {
+        std::cout << "\nTrend weight is within " << WEIGHT_TARGET_STEP_KG << " kg of " << p.weight_kg
+                  << " kg, so your targets stay the same.\n";
+        pauseConsole();
+        return;
+    }
 
-    std::fstream file(filename, std::ios::in | std::ios::out);
-    if (!file) {
-        std::cerr << "Error opening file: " << filename << "\n";
+    float weight = (float)(std::round(trend.smoothedKg * 10.0) / 10.0);
+    bool saved = updateProfile(p, [weight](UserProfile& stored) {
+        stored.weight_kg = weight;
+        calcMacroTargets(stored);
+    });
+    if (!saved) {
+        std::cerr << "Error updating profile for " << p.username << "\n";
         pauseConsole();
         return;
     }
+    std::cout << "\nTargets recalculated for " << p.weight_kg << " kg.\n";
+    displayNutritionTargets(p);
+}
 
-    file.seekp(0);
-    writeProfileBlock(file, p);
+// Lets the user pick the BMR formula and macro split, then recalculates the
+// targets and saves the profile.
+void runTargetSettings(UserProfile& p) {
+    while (true) {
+        printNutritionTargets(p);
+        std::cout << "1. Change BMR formula\n2. Change macro split\nChoice [Enter = back]: ";
+        std::string choice;
+        std::getline(std::cin, choice);
+        choice = trim(choice);
+        if (choice.empty() || checkForBack(choice) || !std::cin) return;
 
-    file.close();
-    std::cout << "Profile updated and weight history recorded.\n";
-    pauseConsole();
-}
\ No newline at end of file
+        std::function<void(UserProfile&)> change;
+
+        if (choice == "1") {
+            for (int f = 0; f < BMR_FORMULAS; ++f) {
+                std::cout << f + 1 << ". " << BMR_FORMULA_NAMES[f] << (f == BMR_KATCH_MCARDLE ? " (uses body fat %)" : "")
+                          << (f == p.bmrFormula ? "  <- current" : "") << "\n";
+            }
+            std::cout << "Formula: ";
+            std::string input;
+            std::getline(std::cin, input);
+            int f = 0;
+            try { f = std::stoi(trim(input)); } catch (...) { f = 0; }
+            if (f < 1 || f > BMR_FORMULAS) continue;
+            float bodyFat = p.bodyFatPercent;
+            if (f - 1 == BMR_KATCH_MCARDLE) {
+                std::cout << "Body fat % [" << (p.bodyFatPercent > 0 ? std::to_string((int)p.bodyFatPercent) : "required") << "]: ";
+                std::getline(std::cin, input);
+                double bf = p.bodyFatPercent;
+                try { if (!trim(input).empty()) bf = std::stod(trim(input)); } catch (...) { bf = 0.0; }
+                if (bf < 3.0 || bf > 70.0) {
+                    std::cout << "Katch-McArdle needs a body fat percentage between 3 and 70.\n";
+                    pauseConsole();
+                    continue;
+                }
+                bodyFat = (float)bf;
+            }
+            BmrFormula formula = (BmrFormula)(f - 1);
+            change = [formula, bodyFat](UserProfile& stored) {
+                stored.bmrFormula = formula;
+                stored.bodyFatPercent = bodyFat;
+            };
+        } else if (choice == "2") {
+            for (int s = 0; s < MACRO_STRATEGIES; ++s) {
+                const MacroSplit& split = MACRO_SPLITS[s];
+                std::cout << s + 1 << ". " << left << setw(14) << split.name << right << split.proteinPerKg << " g/kg protein, "
+                          << (int)std::round(split.carbShare * 100) << "% carbs, " << (int)std::round(split.fatShare * 100)
+                          << "% fat" << (s == p.macroStrategy ? "  <- current" : "") << "\n";
+            }
+            std::cout << "Macro split: ";
+            std::string input;
+            std::getline(std::cin, input);
+            int s = 0;
+            try { s = std::stoi(trim(input)); } catch (...) { s = 0; }
+            if (s < 1 || s > MACRO_STRATEGIES) continue;
+            MacroStrategy strategy = (MacroStrategy)(s - 1);
+            change = [strategy](UserProfile& stored) { stored.macroStrategy = strategy; };
+        } else {
+            continue;
+        }
+
+        bool saved = updateProfile(p, [&change](UserProfile& stored) {
+            change(stored);
+            calcMacroTargets(stored);
+        });
+        if (!saved) {
+            std::cerr << "Error updating profile for " << p.username << "\n";
+            pauseConsole();
+        }
+    }
+}
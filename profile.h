@@ -10,6 +10,13 @@
  */
 void calcMacroTargets(UserProfile& p);
 
+/**
+ * BMR with the user's formula (targets.h), and the activity factor that turns
+ * it into the TDEE.
+ */
+double calcBMR(const UserProfile& p);
+double activityMultiplier(ActivityLevel level);
+
 /**
  * Displays the user's daily nutrition targets (calories, protein, carbs, fat).
  * Used in dashboard menu option 2.
@@ -23,22 +30,30 @@ void displayNutritionTargets(const UserProfile& p);
 void displayProfile(const UserProfile& p);
 
 /**
- * Creates (or overwrites) the per-user data file and writes the USER_PROFILE block.
+ * Saves a new profile in the profile store (profilestore.h) and sets its user ID.
  * Called during registration after collecting profile.
  */
-void createUserDataFile(const std::string& filename, const UserProfile& p);
+bool createUserProfile(UserProfile& p);
 
 /**
- * Loads the USER_PROFILE block from the per-user data file into the profile struct.
- * Called after successful login.
+ * Loads the user's record from the profile store into the profile struct and
+ * recalculates the targets. Called after successful login.
  */
-void loadProfileFromFile(const std::string& filename, UserProfile& p);
+bool loadUserProfile(const std::string& username, UserProfile& p);
 
 /**
- * Prompts for new weight, recalculates targets, rewrites USER_PROFILE block,
- * and changes WEIGHT_UPDATE block to the file.
+ * Shows the weight trend, records a new weigh-in in the weight history
+ * (weight.h) and, when the smoothed weight has moved enough, recalculates the
+ * targets and saves the profile.
  * Called from dashboard menu (e.g. option 8).
  */
-void updateWeightAndTargets(const std::string& filename, UserProfile& p);
+void updateWeightAndTargets(UserProfile& p);
+
+/**
+ * Shows the targets with the user's BMR formula and macro split and lets the
+ * user change either (see targets.h); targets are recalculated and saved.
+ * Used in dashboard menu option 2.
+ */
+void runTargetSettings(UserProfile& p);
 
 #endif // PROFILE_H
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include "profilestore.h"
+#include "checksum.h"
+#include "filelock.h"
+#include "targets.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+using namespace std;
+
+static const char* const profileFileName = PROFILE_STORE_FILE;
+static const char profileMagic[4] = { 'N', 'P', 'R', 'F' };
+static const uint32_t profileVersion = 1;
+static const streamoff profileHeaderBytes = PROFILE_HEADER_BYTES;
+
+// Each user's ID is kept in their directory, so a lookup reads that small file
+// and one record. profileIdsMarker records that the ID files of the users
+// stored before them have been written.
+static const char* const profileIdFile = "profile_id.txt";
+static const char* const profileIdsMarker = "profiles.ids";
+
+// username -> ID, for the users looked up or written in this session
+static unordered_map<string, uint32_t> userIds;
+static uint32_t recordCount = 0;
+static bool indexLoaded = false;
+
+static streamoff recordOffset(uint32_t id) {
+    return profileHeaderBytes + (streamoff)id * (streamoff)sizeof(ProfileRecord);
+}
+
+// Copies s into a NUL-padded field, cutting it before a UTF-8 character that
+// would not fit whole.
+static void copyField(char* field, size_t size, string_view s) {
+    size_t n = min(s.size(), size - 1);
+    if (n < s.size()) {
+        while (n > 0 && ((unsigned char)s[n] & 0xC0) == 0x80) --n;
+    }
+    memset(field, 0, size);
+    memcpy(field, s.data(), n);
+}
+
+static string_view fieldText(const char* field, size_t size) {
+    return string_view(field, strnlen(field, size));
+}
+
+static uint32_t recordChecksum(const ProfileRecord& r) {
+    return crc32c(&r, offsetof(ProfileRecord, checksum));
+}
+
+// Records saved before checksums have 0 there; the next save adds one.
+static bool recordIntact(const ProfileRecord& r) {
+    return r.checksum == 0 || r.checksum == recordChecksum(r);
+}
+
+static void reportDamagedRecord(uint32_t id) {
+    reportChecksumMismatch(profileFileName, "checksum mismatch in record " + to_string(id));
+}
+
+// Opens the file for reading and checks its header.
+static bool openProfileFile(ifstream& file) {
+    file.open(profileFileName, ios::binary);
+    if (!file) return false;
+    char magic[4];
+    uint32_t version = 0;
+    file.read(magic, 4);
+    file.read((char*)&version, sizeof(version));
+    return file && memcmp(magic, profileMagic, 4) == 0 && version == profileVersion;
+}
+
+// Takes the number of records from the file size, including records other
+// sessions have appended since. A short last record (interrupted append) is
+// ignored.
+static void refreshIndex() {
+    indexLoaded = true;
+    error_code ec;
+    uintmax_t bytes = filesystem::file_size(profileFileName, ec);
+    recordCount = !ec && bytes > (uintmax_t)profileHeaderBytes
+                      ? (uint32_t)((bytes - profileHeaderBytes) / sizeof(ProfileRecord))
+                      : 0;
+}
+
+static void loadIndex() {
+    if (!indexLoaded) refreshIndex();
+}
+
+// Reads every username in one pass (batch jobs).
+static void scanIndex() {
+    loadIndex();
+    vector<ProfileRecord> records;
+    readProfileRecords(records);
+    for (uint32_t id = 0; id < records.size(); ++id) {
+        if (records[id].username[0] != '\0') userIds[string(fieldText(records[id].username, PROFILE_USERNAME_BYTES))] = id;
+    }
+    recordCount = max(recordCount, (uint32_t)records.size());
+}
+
+static void packProfile(const UserProfile& p, ProfileRecord& r) {
+    memset(&r, 0, sizeof(r));
+    copyField(r.username, PROFILE_USERNAME_BYTES, p.username);
+    copyField(r.fullName, PROFILE_NAME_BYTES, p.fullName());
+    r.heightCm = p.height_cm;
+    r.weightDg = (uint16_t)lround(max(p.weight_kg, 0.0f) * 10.0f);
+    r.bodyFatDp = (uint16_t)lround(max(p.bodyFatPercent, 0.0f) * 10.0f);
+    r.calorieTarget = (uint16_t)max((int)p.dailyCaloriesTarget, 0);
+    r.age = (uint8_t)min<int>(p.age, 255);
+    r.gender = p.gender;
+    r.activityLevel = p.activityLevel;
+    r.bmrFormula = p.bmrFormula;
+    r.macroStrategy = p.macroStrategy;
+}
+
+void unpackProfile(const ProfileRecord& r, uint32_t id, UserProfile& p, bool internName) {
+    p.userId = id;
+    p.username = string(fieldText(r.username, PROFILE_USERNAME_BYTES));
+    p.fullNameId = internName ? internString(fieldText(r.fullName, PROFILE_NAME_BYTES)) : 0;
+    p.age = r.age;
+    p.height_cm = r.heightCm;
+    p.weight_kg = r.weightDg / 10.0f;
+    p.bodyFatPercent = r.bodyFatDp / 10.0f;
+    p.gender = r.gender == GENDER_MALE ? GENDER_MALE : GENDER_FEMALE;
+    p.activityLevel = (ActivityLevel)(r.activityLevel % ACTIVITY_LEVELS);
+    p.bmrFormula = (BmrFormula)(r.bmrFormula % BMR_FORMULAS);
+    p.macroStrategy = (MacroStrategy)(r.macroStrategy % MACRO_STRATEGIES);
+    p.dailyCaloriesTarget = r.calorieTarget;
+}
+
+// --- Records ---
+
+uint32_t profileCount() {
+    loadIndex();
+    return recordCount;
+}
+
+bool readProfileRecord(uint32_t id, ProfileRecord& record) {
+    loadIndex();
+    if (id >= recordCount) refreshIndex();
+    if (id >= recordCount) return false;
+    ifstream file;
+    if (!openProfileFile(file)) return false;
+    file.seekg(recordOffset(id));
+    file.read((char*)&record, sizeof(record));
+    if (!file) return false;
+    if (!recordIntact(record)) {
+        reportDamagedRecord(id);
+        return false;
+    }
+    return true;
+}
+
+bool writeProfileRecord(uint32_t id, const ProfileRecord& record) {
+    loadIndex();
+    if (id > recordCount) refreshIndex();
+    if (id > recordCount) return false;
+    if (recordCount == 0) {
+        // New file: header first
+        ofstream out(profileFileName, ios::binary | ios::trunc);
+        out.write(profileMagic, 4);
+        out.write((const char*)&profileVersion, sizeof(profileVersion));
+        if (!out) return false;
+    }
+    fstream file(profileFileName, ios::binary | ios::in | ios::out);
+    if (!file) return false;
+    ProfileRecord sealed = record;
+    sealed.checksum = recordChecksum(sealed);
+    file.seekp(recordOffset(id));
+    file.write((const char*)&sealed, sizeof(sealed));
+    if (!file) return false;
+    if (id == recordCount) recordCount++;
+    userIds[string(fieldText(record.username, PROFILE_USERNAME_BYTES))] = id;
+    return true;
+}
+
+bool readProfileRecords(vector<ProfileRecord>& records) {
+    records.clear();
+    ifstream file;
+    if (!openProfileFile(file)) return false;
+    file.seekg(0, ios::end);
+    streamoff bytes = (streamoff)file.tellg() - profileHeaderBytes;
+    records.resize(bytes > 0 ? (size_t)bytes / sizeof(ProfileRecord) : 0);
+    file.seekg(profileHeaderBytes);
+    file.read((char*)records.data(), records.size() * sizeof(ProfileRecord));
+    if (!file) return false;
+    for (uint32_t id = 0; id < records.size(); ++id) {
+        if (recordIntact(records[id])) continue;
+        reportDamagedRecord(id);
+        memset(&records[id], 0, sizeof(ProfileRecord));
+    }
+    return true;
+}
+
+uint32_t verifyProfileRecords(uint32_t first, uint32_t count, vector<uint32_t>& damaged, uint32_t* checked) {
+    ifstream file;
+    if (!openProfileFile(file)) return 0;
+    vector<ProfileRecord> records(count);
+    file.seekg(recordOffset(first));
+    file.read((char*)records.data(), count * sizeof(ProfileRecord));
+    uint32_t n = (uint32_t)((size_t)file.gcount() / sizeof(ProfileRecord));
+    for (uint32_t i = 0; i < n; ++i) {
+        if (!recordIntact(records[i])) damaged.push_back(first + i);
+        if (checked && records[i].checksum != 0) (*checked)++;
+    }
+    return n;
+}
+
+size_t writeCalorieTargets(const vector<uint32_t>& ids, const vector<int>& calories,
+                           const vector<uint32_t>& checksums) {
+    loadIndex();
+    fstream file(profileFileName, ios::binary | ios::in | ios::out);
+    if (!file) return 0;
+    size_t written = 0;
+    ProfileRecord r;
+    for (size_t i = 0; i < ids.size() && i < calories.size() && i < checksums.size(); ++i) {
+        if (ids[i] >= recordCount) continue;
+        file.seekg(recordOffset(ids[i]));
+        if (!file.read((char*)&r, sizeof(r))) break;
+
+        // Read again under the user's lock, which updateProfile holds for its
+        // read-modify-write
+        string username(fieldText(r.username, sizeof(r.username)));
+        FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+        file.seekg(recordOffset(ids[i]));
+        if (!file.read((char*)&r, sizeof(r))) break;
+        if (!recordIntact(r)) {
+            reportDamagedRecord(ids[i]);
+            continue;
+        }
+        if (r.checksum != checksums[i]) continue;   // changed since: its own update set the target
+
+        // The whole record is rewritten, as the checksum covers the target
+        r.calorieTarget = (uint16_t)max(calories[i], 0);
+        r.checksum = recordChecksum(r);
+        file.seekp(recordOffset(ids[i]));
+        file.write((const char*)&r, sizeof(r));
+        if (!file) break;
+        written++;
+    }
+    return written;
+}
+
+// --- Profiles ---
+
+bool readProfile(uint32_t id, UserProfile& p) {
+    ProfileRecord r;
+    if (!readProfileRecord(id, r)) return false;
+    unpackProfile(r, id, p);
+    return true;
+}
+
+// --- ID files ---
+
+static void saveUserId(const string& username, uint32_t id) {
+    ensureUserDir(username);
+    ofstream out(userFilePath(username, profileIdFile), ios::trunc);
+    out << id << "\n";
+}
+
+// The ID in the user's ID file, if the record there is still theirs.
+static uint32_t storedUserId(const string& username) {
+    ifstream in(userFilePath(username, profileIdFile));
+    uint32_t id = NO_USER_ID;
+    ProfileRecord r;
+    if (!(in >> id) || !readProfileRecord(id, r)) return NO_USER_ID;
+    return fieldText(r.username, PROFILE_USERNAME_BYTES) == username ? id : NO_USER_ID;
+}
+
+// Writes the ID files of a store that predates them, once, under the store's
+// lock. From then on a user without an ID file has no record.
+static void ensureIdFiles() {
+    error_code ec;
+    if (filesystem::exists(profileIdsMarker, ec)) return;
+    FileLock lock(PROFILES_LOCK_FILE, LOCK_MODE_EXCLUSIVE);
+    if (filesystem::exists(profileIdsMarker, ec)) return;
+    vector<ProfileRecord> records;
+    readProfileRecords(records);
+    for (uint32_t id = 0; id < records.size(); ++id) {
+        if (records[id].username[0] != '\0') saveUserId(string(fieldText(records[id].username, PROFILE_USERNAME_BYTES)), id);
+    }
+    ofstream marker(profileIdsMarker, ios::trunc);
+    marker << "ID files written\n";
+}
+
+bool writeProfile(UserProfile& p) {
+    loadIndex();
+    ProfileRecord r;
+    packProfile(p, r);
+    if (p.userId != NO_USER_ID) return writeProfileRecord(p.userId, r);
+
+    // A new ID is the next record: taken under the store's lock, unless another
+    // session has stored the user meanwhile
+    FileLock lock(PROFILES_LOCK_FILE, LOCK_MODE_EXCLUSIVE);
+    ensureIdFiles();
+    refreshIndex();
+    uint32_t existing = storedUserId(p.username);
+    p.userId = existing != NO_USER_ID ? existing : recordCount;
+    if (!writeProfileRecord(p.userId, r)) return false;
+    if (existing == NO_USER_ID) saveUserId(p.username, p.userId);
+    return true;
+}
+
+bool updateProfile(UserProfile& p, const function<void(UserProfile&)>& change) {
+    ensureUserDir(p.username);   // for its lock file
+    FileLock lock(userLockFile(p.username), LOCK_MODE_EXCLUSIVE);
+    uint32_t id = p.userId != NO_USER_ID ? p.userId : findUserId(p.username);
+    if (id == NO_USER_ID || !readProfile(id, p)) return false;
+    change(p);
+    return writeProfile(p);
+}
+
+// --- Import ---
+
+bool readProfileBlock(istream& in, const string& username, UserProfile& p) {
+    p.username = username;
+    string line;
+    bool inProfile = false;
+    while (getline(in, line)) {
+        if (line == "USER_PROFILE") { inProfile = true; continue; }
+        if (!inProfile) continue;
+        if (line.empty()) break;
+
+        size_t colon = line.find(": ");
+        if (colon == string::npos) continue;
+        string key = line.substr(0, colon);
+        string val = line.substr(colon + 2);
+        try {
+            if (key == "Name") p.fullNameId = internString(val);
+            else if (key == "Age") p.age = (uint16_t)stoi(val);
+            else if (key == "Gender") p.gender = val == "Male" ? GENDER_MALE : GENDER_FEMALE;
+            else if (key == "Height") p.height_cm = (uint16_t)stod(val);
+            else if (key == "Weight") p.weight_kg = stof(val);
+            else if (key == "Activity_Level") p.activityLevel = parseActivityLevel(val);
+            else if (key == "Daily_Calorie_Target") p.dailyCaloriesTarget = stod(val);
+            else if (key == "Body_Fat") p.bodyFatPercent = stof(val);
+            else if (key == "BMR_Formula") p.bmrFormula = parseBmrFormula(val);
+            else if (key == "Macro_Strategy") p.macroStrategy = parseMacroStrategy(val);
+        } catch (...) {
+            continue;
+        }
+    }
+    return inProfile;
+}
+
+static bool importProfileBlock(const string& username, UserProfile& p) {
+    ifstream fin(userFilePath(username, "data.txt"));
+    return fin && readProfileBlock(fin, username, p);
+}
+
+uint32_t findUserId(const string& username) {
+    loadIndex();
+    auto it = userIds.find(username);
+    if (it != userIds.end()) return it->second;
+    if (username.empty() || username.size() >= PROFILE_USERNAME_BYTES) return NO_USER_ID;
+
+    ensureIdFiles();
+    uint32_t id = storedUserId(username);
+    if (id != NO_USER_ID) {
+        userIds[username] = id;
+        return id;
+    }
+
+    UserProfile p;
+    if (!importProfileBlock(username, p) || !writeProfile(p)) return NO_USER_ID;
+    return p.userId;
+}
+
+void importMissingProfiles() {
+    scanIndex();
+    ifstream users("users.txt");
+    string line;
+    while (getline(users, line)) {
+        string username = trim(line.substr(0, line.find('|')));
+        if (!username.empty() && !userIds.count(username)) findUserId(username);
+    }
+}
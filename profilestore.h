@@ -0,0 +1,111 @@
+#ifndef PROFILESTORE_H
+#define PROFILESTORE_H
+
+#include "models.h"
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Profile store: every user's profile as one fixed-size binary record in
+// profiles.dat, after an 8-byte header ("NPRF" + format version). A user's ID
+// is the index of their record, so a profile is read or rewritten with one
+// seek, and batch jobs read the whole population in one sequential pass.
+// Records are stored in the machine's native byte order, like the food log
+// (logstore.h). Each record ends in a CRC32C of the rest (checksum.h), checked
+// whenever the record is read, so a record damaged by an interrupted rewrite is
+// refused instead of read as a wrong profile.
+//
+// A user's ID is also kept in their directory (profile_id.txt), so finding it
+// reads that file and the record it names, however many users there are; a
+// store that predates these files gets them written once, in one pass. New
+// IDs are handed out under the store's lock (filelock.h). Users
+// registered before the store existed are imported once from the
+// USER_PROFILE block of their data file (data.txt in their directory), which is
+// left untouched.
+
+const char* const PROFILE_STORE_FILE = "profiles.dat";
+const size_t PROFILE_HEADER_BYTES = 8;
+const size_t PROFILE_USERNAME_BYTES = 32;   // including the terminating NUL
+const size_t PROFILE_NAME_BYTES = 64;
+
+// One stored profile (128 bytes). Text fields are NUL-padded; numbers are
+// fixed-point where UserProfile uses floats.
+struct ProfileRecord {
+    char username[PROFILE_USERNAME_BYTES];
+    char fullName[PROFILE_NAME_BYTES];      // UTF-8, cut at a character boundary
+    uint16_t heightCm;
+    uint16_t weightDg;                      // weight in tenths of a kg
+    uint16_t bodyFatDp;                     // body fat in tenths of a percent
+    uint16_t calorieTarget;                 // kcal, as last saved
+    uint8_t age;
+    uint8_t gender;                         // Gender
+    uint8_t activityLevel;                  // ActivityLevel
+    uint8_t bmrFormula;                     // BmrFormula
+    uint8_t macroStrategy;                  // MacroStrategy
+    uint8_t reserved[15];                   // zero; room for later fields
+    uint32_t checksum;                      // CRC32C of the bytes before it (0 if saved before checksums)
+};
+
+static_assert(sizeof(ProfileRecord) == 128, "ProfileRecord layout changed");
+
+// The ID of a user, importing a profile that is still only in the text data
+// file. NO_USER_ID if the user has no profile at all.
+uint32_t findUserId(const std::string& username);
+
+// Number of records (IDs run from 0 to profileCount() - 1).
+uint32_t profileCount();
+
+// Record level: one seek per call. Once the index is loaded (any lookup has
+// run), readProfileRecord may be called from several threads as long as
+// nothing writes the store meanwhile. A damaged record reads as false (and is
+// reported once on stderr); writing sets the checksum.
+bool readProfileRecord(uint32_t id, ProfileRecord& record);
+bool writeProfileRecord(uint32_t id, const ProfileRecord& record);
+
+// Every record, in ID order, read in one pass. Damaged records come back
+// zeroed (an empty username), so batch jobs skip them.
+bool readProfileRecords(std::vector<ProfileRecord>& records);
+
+// Checks count records from ID first against their checksums without
+// reporting them; damaged IDs are added to damaged and checked, if given,
+// receives the number of records that had a checksum. Returns the number of
+// records read (fewer at the end of the store).
+uint32_t verifyProfileRecords(uint32_t first, uint32_t count, std::vector<uint32_t>& damaged,
+                              uint32_t* checked = nullptr);
+
+// Copies a record into a profile. The full name is interned (strpool.h) only
+// when internName is set, so batch jobs over all users do not fill the pool.
+void unpackProfile(const ProfileRecord& record, uint32_t id, UserProfile& p, bool internName = true);
+
+// Reads a user's profile by ID.
+bool readProfile(uint32_t id, UserProfile& p);
+
+// Saves a profile. A profile without an ID gets the next free one (p.userId is
+// set); otherwise its record is overwritten in place.
+bool writeProfile(UserProfile& p);
+
+// Read-modify-write of one profile under the user's exclusive lock
+// (filelock.h): the stored profile is read into p, change is applied to it and
+// the result saved, so changes other sessions saved meanwhile are kept.
+// False if the profile could not be read or written.
+bool updateProfile(UserProfile& p, const std::function<void(UserProfile&)>& change);
+
+// Overwrites only the calorie target of each listed record, in one pass over
+// the file. Each record is read again under its user's exclusive lock and
+// written only if its checksum still equals checksums[i] (as read when the
+// target was computed), so a profile updated meanwhile (updateProfile) keeps
+// its own target. Damaged records are left alone. Returns the number of
+// records written.
+size_t writeCalorieTargets(const std::vector<uint32_t>& ids, const std::vector<int>& calories,
+                           const std::vector<uint32_t>& checksums);
+
+// Reads the "Key: Value" lines of a USER_PROFILE block (the text data file
+// format), stopping at the blank line that ends it. False if there is none.
+bool readProfileBlock(std::istream& in, const std::string& username, UserProfile& p);
+
+// Imports every user in users.txt that has no record yet (see findUserId).
+void importMissingProfiles();
+
+#endif
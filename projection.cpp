@@ -0,0 +1,179 @@
+#include "projection.h"
+#include "logstore.h"
+#include "profile.h"
+#include "profilestore.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+static string projectionFileName(const string& username) {
+    return userFilePath(username, "projection.txt");
+}
+
+// --- Model ---
+
+// TDEE at a weight, without adaptation. body is a copy of the profile whose
+// weight is overwritten.
+static double baselineExpenditure(UserProfile& body, double multiplier, double weightKg) {
+    body.weight_kg = (float)weightKg;
+    return calcBMR(body) * multiplier;
+}
+
+static void simulateDay(ProjectionState& s, UserProfile& body, double multiplier, double intake) {
+    double baseline = baselineExpenditure(body, multiplier, s.weightKg);
+    s.adaptationKcal += (ADAPTATION_SHARE * (intake - baseline) - s.adaptationKcal) / ADAPTATION_DAYS;
+    s.weightKg += (intake - (baseline + s.adaptationKcal)) / KCAL_PER_KG;
+}
+
+// --- Persistence ---
+// One line: day|weight|adaptation|intake|loggedDays
+
+static void saveState(const string& username, const ProjectionState& s) {
+    ofstream out(projectionFileName(username), ios::trunc);
+    out << setprecision(17) << dayNumberToDate(s.day) << "|" << s.weightKg << "|" << s.adaptationKcal
+        << "|" << s.intakeKcal << "|" << s.loggedDays << "\n";
+}
+
+static bool loadState(const string& username, ProjectionState& s) {
+    ifstream file(projectionFileName(username));
+    string line;
+    if (!file || !getline(file, line)) return false;
+
+    vector<string> parts;
+    stringstream ss(trim(line));
+    string part;
+    while (getline(ss, part, '|')) parts.push_back(trim(part));
+    if (parts.size() < 5) return false;
+    try {
+        s.day = dateToDayNumber(parts[0]);
+        s.weightKg = stod(parts[1]);
+        s.adaptationKcal = stod(parts[2]);
+        s.intakeKcal = stod(parts[3]);
+        s.loggedDays = stoi(parts[4]);
+    } catch (...) {
+        return false;
+    }
+    return s.day != NO_DAY && s.weightKg > 0;
+}
+
+// --- Public API ---
+
+ProjectionState updateProjection(const UserProfile& p) {
+    int yesterday = dateToDayNumber(getTodayDate()) - 1;
+    ProjectionState checkpoint;
+    if (!loadState(p.username, checkpoint)) {
+        checkpoint = ProjectionState();
+        checkpoint.day = yesterday - PROJECTION_START_DAYS;
+        checkpoint.weightKg = p.weight_kg;
+    }
+    if (checkpoint.day >= yesterday) return checkpoint;   // clock set back
+
+    // Intake of the days since the checkpoint, in one range read
+    int first = checkpoint.day + 1;
+    vector<DayTotals> days(yesterday - first + 1);
+    scanLog(p.username, first, yesterday, [&days, first](const LogRecord& r) {
+        sumLogRecords(&r, 1, days[r.day - first]);
+    });
+
+    UserProfile body = p;
+    double multiplier = activityMultiplier(p.activityLevel);
+    int keepDay = yesterday - PROJECTION_REPLAY_DAYS;
+    ProjectionState s = checkpoint;
+    for (int day = first; day <= yesterday; ++day) {
+        const DayTotals& t = days[day - first];
+        if (t.entries > 0) {
+            double intake = fromFixed(t.calories);
+            s.intakeKcal = s.loggedDays == 0 ? intake : s.intakeKcal + (intake - s.intakeKcal) / INTAKE_SMOOTHING_DAYS;
+            s.loggedDays++;
+            simulateDay(s, body, multiplier, intake);
+        }
+        s.day = day;
+        if (day == keepDay) checkpoint = s;
+    }
+    saveState(p.username, checkpoint);
+    return s;
+}
+
+double projectedExpenditure(const UserProfile& p, const ProjectionState& s) {
+    UserProfile body = p;
+    return baselineExpenditure(body, activityMultiplier(p.activityLevel), s.weightKg) + s.adaptationKcal;
+}
+
+void projectWeights(const UserProfile& p, const ProjectionState& s, double intakeKcal, int days,
+                    vector<double>& weights) {
+    UserProfile body = p;
+    double multiplier = activityMultiplier(p.activityLevel);
+    ProjectionState next = s;
+    weights.resize(max(days, 0));
+    for (int i = 0; i < days; ++i) {
+        simulateDay(next, body, multiplier, intakeKcal);
+        weights[i] = next.weightKg;
+    }
+}
+
+// --- Display and batch ---
+
+void runWeightProjection(const UserProfile& p) {
+    printHeader("WEIGHT PROJECTION", "energy balance with adaptive metabolism");
+    ProjectionState s = updateProjection(p);
+    if (s.loggedDays == 0) {
+        cout << "No logged days to simulate yet. Log your meals for a few days first.\n";
+        pauseConsole();
+        return;
+    }
+
+    const int weeks[] = { 2, 4, 8, 12, 26 };
+    const int horizon = 26 * 7;
+    vector<double> atIntake, atTarget;
+    projectWeights(p, s, s.intakeKcal, horizon, atIntake);
+    projectWeights(p, s, p.dailyCaloriesTarget, horizon, atTarget);
+
+    cout << fixed << setprecision(1);
+    cout << left << setw(22) << "Simulated weight:" << s.weightKg << " kg (" << s.loggedDays << " logged days)\n";
+    cout << left << setw(22) << "Average intake:" << setprecision(0) << s.intakeKcal << " kcal/day\n";
+    cout << left << setw(22) << "Expenditure now:" << projectedExpenditure(p, s) << " kcal/day (adaptation "
+         << showpos << s.adaptationKcal << noshowpos << ")\n\n";
+
+    cout << setprecision(1);
+    cout << left << setw(10) << "Weeks" << setw(20) << "At average intake" << "At target (" << (int)p.dailyCaloriesTarget << " kcal)\n";
+    cout << "--------------------------------------------------------\n";
+    for (int w : weeks) {
+        ostringstream cell;
+        cell << fixed << setprecision(1) << atIntake[w * 7 - 1] << " kg";
+        cout << left << setw(10) << w << setw(20) << cell.str() << atTarget[w * 7 - 1] << " kg\n";
+    }
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+    cout << "\nExpenditure follows the simulated weight, so losses slow down over time.\n";
+    pauseConsole();
+}
+
+void projectAllUsers(ostream& out) {
+    auto start = chrono::steady_clock::now();
+    importMissingProfiles();
+    vector<ProfileRecord> records;
+    readProfileRecords(records);
+
+    out << "username,loggedDays,intake,expenditure,simulatedKg,kg4w,kg12w\n";
+    out << fixed << setprecision(1);
+    vector<double> weights;
+    for (uint32_t id = 0; id < records.size(); ++id) {
+        if (records[id].username[0] == '\0') continue;   // damaged
+        UserProfile p;
+        unpackProfile(records[id], id, p, false);
+        ProjectionState s = updateProjection(p);
+        projectWeights(p, s, s.loggedDays > 0 ? s.intakeKcal : p.dailyCaloriesTarget, 12 * 7, weights);
+        out << p.username << "," << s.loggedDays << "," << s.intakeKcal << "," << projectedExpenditure(p, s)
+            << "," << s.weightKg << "," << weights[4 * 7 - 1] << "," << weights[12 * 7 - 1] << "\n";
+    }
+    out.unsetf(ios::fixed);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "Projected " << records.size() << " profile(s) in " << fixed << setprecision(3) << seconds * 1000.0 << " ms.\n";
+    cerr.unsetf(ios::fixed);
+}
@@ -0,0 +1,61 @@
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include "models.h"
+#include "utils.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Weight projection from energy balance.
+//
+// Each logged day moves a simulated weight by (intake - expenditure) / 7700
+// kcal per kg. Expenditure is the TDEE at the simulated weight (calcBMR times
+// activityMultiplier, profile.h), so it falls as weight falls, plus an
+// adaptive term that follows a share of the energy gap with a two-week lag
+// (metabolism slows in a deficit and speeds up in a surplus). Days without
+// entries are left out.
+//
+// The state is cached in the user's projection.txt as a checkpoint a week
+// behind the last simulated day. Each update resumes from it and simulates
+// only the days since, so entries added or corrected within the last week are
+// picked up without rereading older history. The first update starts four
+// weeks back from the profile weight.
+
+const double KCAL_PER_KG = 7700.0;
+const double ADAPTATION_SHARE = 0.15;       // share of the energy gap the metabolism adapts by
+const double ADAPTATION_DAYS = 14.0;        // time constant of that adaptation
+const double INTAKE_SMOOTHING_DAYS = 14.0;  // time constant of the average intake (logged days)
+const int PROJECTION_REPLAY_DAYS = 7;       // days simulated again on every update
+const int PROJECTION_START_DAYS = 28;       // history simulated by the first update
+
+struct ProjectionState {
+    int day = NO_DAY;             // last simulated day
+    double weightKg = 0.0;
+    double adaptationKcal = 0.0;  // added to the TDEE (negative after a deficit)
+    double intakeKcal = 0.0;      // smoothed intake of logged days
+    int loggedDays = 0;
+};
+
+// Simulates the days up to yesterday, saves the new checkpoint and returns
+// the state after yesterday.
+ProjectionState updateProjection(const UserProfile& p);
+
+// Energy expenditure in the state (TDEE at the simulated weight plus adaptation).
+double projectedExpenditure(const UserProfile& p, const ProjectionState& s);
+
+// Continues the simulation with a fixed daily intake. weights[i] is the
+// weight after day i + 1.
+void projectWeights(const UserProfile& p, const ProjectionState& s, double intakeKcal, int days,
+                    std::vector<double>& weights);
+
+// Reports menu: simulated weight and projections at the average intake and
+// at the calorie target.
+void runWeightProjection(const UserProfile& p);
+
+// "--project-weights": updates every stored profile's projection and writes
+// one CSV line per user:
+// username,loggedDays,intake,expenditure,simulatedKg,kg4w,kg12w
+void projectAllUsers(std::ostream& out);
+
+#endif
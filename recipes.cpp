@@ -0,0 +1,332 @@
+#include "recipes.h"
+#include "catalog.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+using namespace std;
+
+// One recipe with its cached roll-up. inputs holds the definitions of the
+// non-recipe ingredients the roll-up was computed from, so a catalog reload
+// can tell which of them actually changed. An ingredient that was not found
+// is kept as an empty FoodItem (keyId 0), so a reload that adds it counts as
+// a change too.
+struct RecipeEntry {
+    Recipe recipe;
+    vector<uint32_t> ingredientKeys;     // interned normalized ingredient names
+    FoodItem rolled;                     // per 100 g, in the overlay
+    unordered_map<uint32_t, FoodItem> inputs;
+    bool dirty = true;
+};
+
+struct RecipeBook {
+    map<uint32_t, RecipeEntry> recipes;                        // by interned normalized name
+    unordered_map<uint32_t, set<uint32_t>> dependents;         // ingredient -> recipes using it
+};
+
+static map<string, RecipeBook> recipeBooks;
+
+static string recipesFileName(const string& username) {
+    return userFilePath(username, "recipes.txt");
+}
+
+static uint32_t recipeKey(const string& name) {
+    return internString(normalizeFoodName(name));
+}
+
+static bool sameNutrients(const FoodItem& a, const FoodItem& b) {
+    return a.calories == b.calories && a.protein == b.protein && a.carbs == b.carbs &&
+           a.fat == b.fat && a.servingSize == b.servingSize;
+}
+
+// --- Dependency graph ---
+
+static void linkRecipe(RecipeBook& book, uint32_t key) {
+    for (uint32_t ing : book.recipes[key].ingredientKeys) book.dependents[ing].insert(key);
+}
+
+static void unlinkRecipe(RecipeBook& book, uint32_t key) {
+    auto it = book.recipes.find(key);
+    if (it == book.recipes.end()) return;
+    for (uint32_t ing : it->second.ingredientKeys) book.dependents[ing].erase(key);
+}
+
+// True if target is reachable from key through ingredient edges.
+static bool dependsOn(const RecipeBook& book, uint32_t key, uint32_t target, set<uint32_t>& visited) {
+    if (key == target) return true;
+    if (!visited.insert(key).second) return false;
+    auto it = book.recipes.find(key);
+    if (it == book.recipes.end()) return false;
+    for (uint32_t ing : it->second.ingredientKeys) {
+        if (dependsOn(book, ing, target, visited)) return true;
+    }
+    return false;
+}
+
+// Marks every recipe that uses key, directly or indirectly, as dirty.
+static void invalidateDependents(RecipeBook& book, uint32_t key, vector<uint32_t>& marked) {
+    auto it = book.dependents.find(key);
+    if (it == book.dependents.end()) return;
+    for (uint32_t dep : it->second) {
+        RecipeEntry& entry = book.recipes[dep];
+        if (entry.dirty) continue;
+        entry.dirty = true;
+        marked.push_back(dep);
+        invalidateDependents(book, dep, marked);
+    }
+}
+
+// --- Roll-up ---
+
+// Recomputes a dirty recipe after its dirty ingredient recipes and puts the
+// result into the overlay. Cycles are rejected when recipes are saved.
+static void rollUp(const string& username, RecipeBook& book, uint32_t key) {
+    RecipeEntry& entry = book.recipes[key];
+    if (!entry.dirty) return;
+    entry.dirty = false;   // set first so a damaged file with a cycle cannot recurse forever
+
+    double calories = 0, protein = 0, carbs = 0, fat = 0, totalGrams = 0;
+    entry.inputs.clear();
+    for (size_t i = 0; i < entry.recipe.ingredients.size(); ++i) {
+        const RecipeIngredient& ing = entry.recipe.ingredients[i];
+        uint32_t ingKey = entry.ingredientKeys[i];
+        totalGrams += ing.grams;
+
+        FoodItem food;
+        auto sub = book.recipes.find(ingKey);
+        if (sub != book.recipes.end()) {
+            rollUp(username, book, ingKey);
+            food = sub->second.rolled;
+        } else if (findFood(username, ing.name, food)) {
+            entry.inputs[ingKey] = food;
+        } else {
+            entry.inputs[ingKey] = FoodItem();   // unknown: contributes nothing until it exists
+            continue;
+        }
+        double ratio = (food.servingSize > 0) ? ing.grams / food.servingSize : 0.0;
+        calories += food.calories * ratio;
+        protein += food.protein * ratio;
+        carbs += food.carbs * ratio;
+        fat += food.fat * ratio;
+    }
+
+    double yield = (entry.recipe.yieldGrams > 0) ? entry.recipe.yieldGrams : totalGrams;
+    double per100 = (yield > 0) ? 100.0 / yield : 0.0;
+    FoodItem& rolled = entry.rolled;
+    setFoodName(rolled, entry.recipe.name);
+    rolled.unitId = internString("g");
+    rolled.servingSize = 100.0f;
+    rolled.calories = (float)(calories * per100);
+    rolled.protein = (float)(protein * per100);
+    rolled.carbs = (float)(carbs * per100);
+    rolled.fat = (float)(fat * per100);
+    rolled.isCustom = true;
+    putOverlayFood(username, rolled);
+}
+
+static void rollUpDirty(const string& username, RecipeBook& book) {
+    for (auto& r : book.recipes) rollUp(username, book, r.first);
+}
+
+// After a foods.txt reload: re-check the non-recipe ingredients each roll-up
+// used and recompute only the recipes whose inputs changed.
+static void catalogReloaded(const string& username) {
+    auto bookIt = recipeBooks.find(username);
+    if (bookIt == recipeBooks.end()) return;
+    RecipeBook& book = bookIt->second;
+
+    vector<uint32_t> marked;
+    for (auto& r : book.recipes) {
+        RecipeEntry& entry = r.second;
+        if (entry.dirty) continue;
+        for (const auto& input : entry.inputs) {
+            FoodItem current;
+            bool found = findFood(username, string(pooledString(input.first)), current);
+            bool wasFound = input.second.keyId != 0;
+            if (found == wasFound && (!found || sameNutrients(current, input.second))) continue;
+            entry.dirty = true;
+            marked.push_back(r.first);
+            invalidateDependents(book, r.first, marked);
+            break;
+        }
+    }
+    if (!marked.empty()) rollUpDirty(username, book);
+}
+
+// --- Persistence ---
+// RECIPE
+// Name: Doro wat (home)
+// Yield: 1200
+// Ingredient: chicken | 800
+// Ingredient: berbere mix | 30      (may be another recipe)
+// END_RECIPE
+
+static void saveBook(const string& username, const RecipeBook& book) {
+    ensureUserDir(username);
+    ofstream out(recipesFileName(username), ios::trunc);
+    for (const auto& r : book.recipes) {
+        const Recipe& recipe = r.second.recipe;
+        out << "RECIPE\n" << "Name: " << recipe.name << "\n" << "Yield: " << recipe.yieldGrams << "\n";
+        for (const RecipeIngredient& ing : recipe.ingredients) {
+            out << "Ingredient: " << ing.name << " | " << ing.grams << "\n";
+        }
+        out << "END_RECIPE\n\n";
+    }
+}
+
+static void addEntry(RecipeBook& book, const Recipe& recipe) {
+    uint32_t key = recipeKey(recipe.name);
+    unlinkRecipe(book, key);
+    RecipeEntry& entry = book.recipes[key];
+    entry = RecipeEntry();
+    entry.recipe = recipe;
+    for (const RecipeIngredient& ing : recipe.ingredients) entry.ingredientKeys.push_back(recipeKey(ing.name));
+    linkRecipe(book, key);
+}
+
+void loadRecipes(const string& username) {
+    static bool listening = false;
+    if (!listening) {
+        onSharedCatalogReloaded(catalogReloaded);
+        listening = true;
+    }
+    if (recipeBooks.count(username)) return;
+    RecipeBook& book = recipeBooks[username];
+
+    ifstream file(recipesFileName(username));
+    string line;
+    Recipe current;
+    bool inBlock = false;
+    while (getline(file, line)) {
+        string t = trim(line);
+        if (t == "RECIPE") { current = Recipe(); inBlock = true; continue; }
+        if (!inBlock) continue;
+        if (t == "END_RECIPE") {
+            if (!current.name.empty() && !current.ingredients.empty()) addEntry(book, current);
+            inBlock = false;
+        } else if (t.rfind("Name:", 0) == 0) {
+            current.name = trim(t.substr(5));
+        } else if (t.rfind("Yield:", 0) == 0) {
+            try { current.yieldGrams = stod(trim(t.substr(6))); } catch (...) { current.yieldGrams = 0.0; }
+        } else if (t.rfind("Ingredient:", 0) == 0) {
+            string rest = t.substr(11);
+            size_t bar = rest.rfind('|');
+            if (bar == string::npos) continue;
+            RecipeIngredient ing;
+            ing.name = trim(rest.substr(0, bar));
+            try { ing.grams = stod(trim(rest.substr(bar + 1))); } catch (...) { continue; }
+            if (!ing.name.empty() && ing.grams > 0) current.ingredients.push_back(ing);
+        }
+    }
+    rollUpDirty(username, book);
+}
+
+// --- Public API ---
+
+bool saveRecipe(const string& username, const Recipe& recipe) {
+    loadRecipes(username);
+    RecipeBook& book = recipeBooks[username];
+    uint32_t key = recipeKey(recipe.name);
+
+    for (const RecipeIngredient& ing : recipe.ingredients) {
+        set<uint32_t> visited;
+        if (dependsOn(book, recipeKey(ing.name), key, visited)) return false;
+    }
+
+    addEntry(book, recipe);
+    vector<uint32_t> marked;
+    invalidateDependents(book, key, marked);
+    rollUpDirty(username, book);
+    saveBook(username, book);
+    return true;
+}
+
+void recipeIngredientChanged(const string& username, const string& foodName) {
+    loadRecipes(username);
+    RecipeBook& book = recipeBooks[username];
+    vector<uint32_t> marked;
+    invalidateDependents(book, recipeKey(foodName), marked);
+    if (!marked.empty()) rollUpDirty(username, book);
+}
+
+bool getRecipeFood(const string& username, const string& name, FoodItem& out) {
+    loadRecipes(username);
+    RecipeBook& book = recipeBooks[username];
+    auto it = book.recipes.find(recipeKey(name));
+    if (it == book.recipes.end()) return false;
+    out = it->second.rolled;
+    return true;
+}
+
+// --- Menu ---
+
+void runAddRecipe(const UserProfile& p) {
+    printHeader("ADD RECIPE", "ingredients are foods, custom foods or other recipes");
+    Recipe recipe;
+    string input;
+
+    while (true) {
+        cout << "Recipe name (or 'b' to go back): ";
+        getline(cin, input);
+        input = trim(input);
+        if (checkForBack(input)) return;
+        if (input.empty()) { cout << "Name cannot be empty. Try again.\n"; continue; }
+        recipe.name = input;
+        break;
+    }
+
+    while (true) {
+        cout << "\nIngredient " << recipe.ingredients.size() + 1 << " - food to search (Enter when done): ";
+        getline(cin, input);
+        input = trim(input);
+        if (input.empty()) break;
+        if (checkForBack(input)) return;
+
+        vector<FoodItem> matches = searchFoods(p.username, input);
+        if (matches.empty()) { cout << "No matches found.\n"; continue; }
+        size_t shown = min<size_t>(matches.size(), 10);
+        for (size_t i = 0; i < shown; ++i) {
+            cout << i + 1 << ". " << matches[i].name() << " (" << matches[i].calories << " cal per "
+                 << matches[i].servingSize << matches[i].unit() << ")"
+                 << (matches[i].isCustom ? " [custom]" : "") << "\n";
+        }
+        cout << "Select (0 to skip): ";
+        getline(cin, input);
+        int sel = 0;
+        try { sel = stoi(trim(input)); } catch (...) { sel = 0; }
+        if (sel < 1 || sel > (int)shown) continue;
+
+        RecipeIngredient ing;
+        ing.name = string(matches[sel - 1].name());
+        cout << "Grams of " << ing.name << ": ";
+        getline(cin, input);
+        try { ing.grams = stod(trim(input)); } catch (...) { ing.grams = 0.0; }
+        if (ing.grams <= 0) { cout << "Enter a positive number of grams.\n"; continue; }
+        recipe.ingredients.push_back(ing);
+    }
+    if (recipe.ingredients.empty()) { cout << "A recipe needs at least one ingredient.\n"; pauseConsole(); return; }
+
+    cout << "\nCooked weight in grams [Enter = total of the ingredients]: ";
+    getline(cin, input);
+    input = trim(input);
+    if (!input.empty()) {
+        try { recipe.yieldGrams = stod(input); } catch (...) { recipe.yieldGrams = 0.0; }
+    }
+
+    if (!saveRecipe(p.username, recipe)) {
+        cout << "\nA recipe cannot contain itself (directly or through another recipe).\n";
+        pauseConsole();
+        return;
+    }
+    FoodItem rolled;
+    getRecipeFood(p.username, recipe.name, rolled);
+    cout << fixed << setprecision(1)
+         << "\n✓ Recipe saved. Per 100g: " << rolled.calories << " cal, " << rolled.protein << "g protein, "
+         << rolled.carbs << "g carbs, " << rolled.fat << "g fat\n";
+    cout.unsetf(ios::fixed);
+    pauseConsole();
+}
@@ -0,0 +1,52 @@
+#ifndef RECIPES_H
+#define RECIPES_H
+
+#include "models.h"
+#include <string>
+#include <vector>
+
+// User-defined recipes (composite foods).
+//
+// A recipe lists ingredients with grams and a cooked yield. An ingredient may
+// be a catalog food, a custom food or another recipe. Each recipe's nutrients
+// are rolled up once per 100 g and put into the user's custom overlay, so
+// search, logging and recommendations treat it like any other custom food.
+//
+// Roll-ups are cached. When an ingredient changes (a recipe is redefined, a
+// custom food is replaced, or foods.txt is reloaded), only the recipes that
+// depend on it, directly or through other recipes, are recomputed, each after
+// its own ingredients. An ingredient that does not exist yet contributes
+// nothing; a reload that adds it recomputes the recipe.
+//
+// Recipes are stored in the user's recipes.txt as RECIPE blocks.
+
+struct RecipeIngredient {
+    std::string name;
+    double grams = 0.0;
+};
+
+struct Recipe {
+    std::string name;
+    double yieldGrams = 0.0;                   // cooked weight; 0 = sum of the ingredients
+    std::vector<RecipeIngredient> ingredients;
+};
+
+// Loads the user's recipes and puts their roll-ups into the overlay.
+// Called after login; later calls do nothing.
+void loadRecipes(const std::string& username);
+
+// Saves (or replaces) a recipe and updates every recipe that depends on it.
+// Returns false, and changes nothing, if the recipe would contain itself.
+bool saveRecipe(const std::string& username, const Recipe& recipe);
+
+// Recomputes the recipes that use the named food after it changed
+// (for example a replaced custom food).
+void recipeIngredientChanged(const std::string& username, const std::string& foodName);
+
+// Current roll-up of a recipe (per 100 g). Returns false if there is none.
+bool getRecipeFood(const std::string& username, const std::string& name, FoodItem& out);
+
+// "Add Custom Food" flow for a recipe: name, ingredients, yield.
+void runAddRecipe(const UserProfile& p);
+
+#endif
@@ -1,5 +1,8 @@
 #include "recommendations.h"
 #include "utils.h"
+#include "usage.h"
+#include "catalog.h"
+#include "logstore.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -14,14 +17,17 @@ using namespace std;
 
 // --- Helper Structures ---
 
+// Names and units are interned IDs (see strpool.h), so filtering, sorting
+// and copying candidates never allocates.
 struct RecFoodItem {
-    string name;
+    uint32_t nameId;
     double calories;
     double protein;
     double carbs;
     double fat;
-    string servingUnitStr; 
+    uint32_t unitId;       // serving unit ("g", "ml", "pc")
     double servingSizeVal; // numeric value of serving size
+    double usageScore = 0.0; // 0..1, how often/recently the user logged it (see usage.h)
 };
 
 struct NutrientStatus {
@@ -39,6 +45,19 @@ struct Recommendation {
 
 // --- Helper Functions ---
 
+// Converts a catalog record into the recommendation engine's food item.
+RecFoodItem toRecFoodItem(const FoodItem& f) {
+    RecFoodItem item;
+    item.nameId = f.nameId;
+    item.calories = f.calories;
+    item.protein = f.protein;
+    item.carbs = f.carbs;
+    item.fat = f.fat;
+    item.unitId = f.unitId;
+    item.servingSizeVal = f.servingSize;
+    return item;
+}
+
 // Get current date string YYYY-MM-DD
 // Uses system time to generate a formatted date string for today.
 string getCurrentDateRecs() {
@@ -50,168 +69,24 @@ string getCurrentDateRecs() {
     return string(buf);
 }
 
-// Parse serving size string like "100g", "200ml", "1pc" => {value: 100, unit: "g"}
-// Helper to split a serving size string into its numeric value and unit.
-pair<double, string> parseServingSize(string s) {
-    string numPart = "";
-    string unitPart = "";
-    bool readingNum = true;
-    for (char c : s) {
-        if (readingNum && (isdigit(c) || c == '.')) {
-            numPart += c;
-        } else {
-            readingNum = false;
-            unitPart += c;
-        }
-    }
-    double val = 1.0;
-    if (!numPart.empty()) {
-        try {
-            val = stod(numPart);
-        } catch (...) {
-            val = 1.0;
-        }
-    }
-    // Clean up unit part (remove spaces)
-    unitPart = trim(unitPart);
-    if (unitPart.empty()) unitPart = "unit";
-    return {val, unitPart};
-}
-
-// Load foods from foods.txt
-// Reads the entire food database and parses each line into a RecFoodItem.
-// Handles potential parsing errors gracefully by skipping malformed lines.
-vector<RecFoodItem> loadRecFoodDatabase() {
-    vector<RecFoodItem> foods;
-    ifstream file("foods.txt");
-    if (!file.is_open()) {
-        cout << "Error opening foods.txt" << endl;
-        return foods;
-    }
-
-    string line;
-    // skip header
-    if(getline(file, line)) {
-        if(line.size() > 0 && tolower(line[0]) == 'f' && line.find('|') != string::npos) {
-            // it's header
-        }
-    }
-
-    while (getline(file, line)) {
-        if (line.empty()) continue;
-        stringstream ss(line);
-        string segment;
-        vector<string> parts;
-        while (getline(ss, segment, '|')) {
-            parts.push_back(trim(segment));
-        }
-
-        if (parts.size() >= 6) {
-            RecFoodItem item;
-            item.name = parts[0];
-            try {
-                item.calories = stod(parts[1]);
-                item.protein = stod(parts[2]);
-                item.carbs = stod(parts[3]);
-                item.fat = stod(parts[4]);
-                
-                pair<double, string> serving = parseServingSize(parts[5]);
-                item.servingSizeVal = serving.first;
-                item.servingUnitStr = serving.second;
-                
-                foods.push_back(item);
-            } catch (...) {
-                continue;
-            }
-        }
-    }
-    file.close();
-    return foods;
-}
-
 // Load user's consumed totals for today
-// parses the user's data file to sum up calories and macros consumed so far today.
+// Sums today's entries from the user's binary log (exact fixed-point totals).
 NutrientStatus getConsumedToday(const string& username) {
     NutrientStatus consumed;
-    string filename = "user_" + username + "_data.txt";
-    ifstream file(filename);
-    if (!file.is_open()) return consumed;
-
-    string line;
-    string today = getCurrentDateRecs();
-    bool isInTodayLog = false;
-
-    // Scan the file
-    while (getline(file, line)) {
-        line = trim(line);
-        if (line == "DAILY_LOG") {
-            isInTodayLog = false; // reset until date confirmed
-            continue;
-        }
-        if (line.rfind("Date:", 0) == 0) { // starts with Date:
-            string dateStr = trim(line.substr(5));
-            if (dateStr == today) {
-                isInTodayLog = true;
-            }
-            continue;
-        }
-        if (line == "END_DAILY_LOG") {
-            isInTodayLog = false;
-            continue;
-        }
-
-        if (isInTodayLog && !line.empty()) {
-            if (line.find('|') != string::npos && line.find("Type:") == string::npos) {
-                vector<string> parts;
-                stringstream ss(line);
-                string segment;
-                while (getline(ss, segment, '|')) {
-                    parts.push_back(trim(segment));
-                }
-                if (parts.size() >= 5) { 
-                    try {
-                        consumed.calories += stod(parts[1]);
-                        consumed.protein += stod(parts[2]);
-                        consumed.carbs += stod(parts[3]);
-                        consumed.fat += stod(parts[4]);
-                    } catch (...) {}
-                }
-            }
-        }
-    }
-    file.close();
+    DayTotals totals = getDayTotals(username, dateToDayNumber(getCurrentDateRecs()));
+    consumed.calories = fromFixed(totals.calories);
+    consumed.protein = fromFixed(totals.protein);
+    consumed.carbs = fromFixed(totals.carbs);
+    consumed.fat = fromFixed(totals.fat);
     return consumed;
 }
 
 // Helper to save selected recommendation
 // Appends the chosen food recommendation to the user's daily log immediately.
 void autoAddFood(const string& username, const RecFoodItem& food, double amount) {
-    string filename = "user_" + username + "_data.txt";
-    string today = getCurrentDateRecs();
-    
-    ofstream outfile(filename, ios::app);
-    if (outfile.is_open()) {
-        outfile << "\nDAILY_LOG\n";
-        outfile << "Date: " << today << "\n";
-        outfile << "Type: Auto-Added Recommendation\n";
-        
-        // Calculate nutrients for the specific amount
-        double ratio = amount / food.servingSizeVal;
-        
-        double cals = food.calories * ratio;
-        double prot = food.protein * ratio;
-        double carb = food.carbs * ratio;
-        double fat = food.fat * ratio;
-        
-        outfile << food.name << " | " 
-                << fixed << setprecision(1) << cals << " | "
-                << prot << " | "
-                << carb << " | "
-                << fat << " | "
-                << amount << food.servingUnitStr << "\n";
-        
-        outfile << "END_DAILY_LOG\n";
-        outfile.close();
+    FoodItem catalogFood;
+    if (findFood(username, string(pooledString(food.nameId)), catalogFood) &&
+        logFood(username, catalogFood, amount, MEAL_AUTO_ADDED)) {
         cout << "\n✅ Food auto-added to today's log!\n";
     } else {
         cout << "\n❌ Error writing to log file.\n";
@@ -288,44 +163,42 @@ void runMealRecommendations(const UserProfile& p) {
             continue;
         }
 
-        // 2. Load Foods
-        vector<RecFoodItem> allFoods = loadRecFoodDatabase();
+        // 2. Load Foods & 3. Filter/Categorize
+        // The catalog keeps each nutrient ranking pre-sorted (shared foods plus the
+        // user's custom foods), so the filter is just a prefix of that ranking.
+        // Criteria from prompt: "High Protein foods (protein >= 15g / 100g)"
+        Nutrient focus = NUTRIENT_PROTEIN;
+        double minPer100 = 15.0;
+        if (choice == 'B') { focus = NUTRIENT_CARBS; minPer100 = 20.0; }
+        else if (choice == 'C') { focus = NUTRIENT_FAT; minPer100 = 10.0; }
+
+        vector<FoodItem> candidates = foodsRankedBy(p.username, focus, minPer100);
+        if (candidates.empty()) candidates = foodsRankedBy(p.username, focus, -1.0);
+
         vector<RecFoodItem> filteredFoods;
+        for (const FoodItem& f : candidates) filteredFoods.push_back(toRecFoodItem(f));
 
-        // 3. Filter/Categorize
-        for (size_t i = 0; i < allFoods.size(); i++) {
-            RecFoodItem f = allFoods[i];
-            double norm = (f.servingSizeVal > 0) ? (100.0 / f.servingSizeVal) : 1.0;
-            double p100 = f.protein * norm;
-            double c100 = f.carbs * norm;
-            double f100 = f.fat * norm;
-
-            bool keep = false;
-            // Criteria from prompt: "High Protein foods (protein >= 15g / 100g)"
-            if (choice == 'A') { 
-                if (p100 >= 15.0) keep = true; 
-            } else if (choice == 'B') { 
-                 if (c100 >= 20.0) keep = true;
-            } else if (choice == 'C') { 
-                 if (f100 >= 10.0) keep = true;
-            }
-            if (keep) filteredFoods.push_back(f);
+        for (size_t i = 0; i < filteredFoods.size(); ++i) {
+            filteredFoods[i].usageScore = usageScore(p.username, string(pooledString(filteredFoods[i].nameId)));
         }
 
-        if (filteredFoods.empty()) filteredFoods = allFoods;
-
         // Sort by amount per serving (descending) using simple Bubble Sort
         // (Avoiding lambdas for beginner friendliness)
+        // Foods the user logs often get up to a 50% boost, so familiar foods
+        // win over slightly richer ones they never eat.
         for (size_t i = 0; i < filteredFoods.size(); ++i) {
             for (size_t j = 0; j < filteredFoods.size() - 1; ++j) {
-                bool swapNeeded = false;
+                double a = 0, b = 0;
                 if (choice == 'A') {
-                    if (filteredFoods[j].protein < filteredFoods[j+1].protein) swapNeeded = true;
+                    a = filteredFoods[j].protein; b = filteredFoods[j+1].protein;
                 } else if (choice == 'B') {
-                    if (filteredFoods[j].carbs < filteredFoods[j+1].carbs) swapNeeded = true;
+                    a = filteredFoods[j].carbs; b = filteredFoods[j+1].carbs;
                 } else {
-                    if (filteredFoods[j].fat < filteredFoods[j+1].fat) swapNeeded = true;
+                    a = filteredFoods[j].fat; b = filteredFoods[j+1].fat;
                 }
+                a *= 1.0 + 0.5 * filteredFoods[j].usageScore;
+                b *= 1.0 + 0.5 * filteredFoods[j+1].usageScore;
+                bool swapNeeded = a < b;
                 
                 if (swapNeeded) {
                     RecFoodItem temp = filteredFoods[j];
@@ -364,7 +237,8 @@ void runMealRecommendations(const UserProfile& p) {
             double requiredServings = goal / nutrientPerServing;
             double finalAmount = requiredServings * f.servingSizeVal;
             
-            if (f.servingUnitStr == "g" || f.servingUnitStr == "ml") {
+            string_view unit = pooledString(f.unitId);
+            if (unit == "g" || unit == "ml") {
                 finalAmount = round(finalAmount);
             } else {
                  finalAmount = round(finalAmount * 10) / 10.0;
@@ -380,9 +254,16 @@ void runMealRecommendations(const UserProfile& p) {
 
         cout << "\nSuggested Options:\n";
         for (size_t i = 0; i < topOptions.size(); ++i) {
-            cout << (i+1) << ") " << topOptions[i].food.name 
-                 << " - " << topOptions[i].recommendedAmount << topOptions[i].food.servingUnitStr 
-                 << " (" << (int)topOptions[i].nutrientContributed << "g " << nutName << ")\n";
+            string_view name = pooledString(topOptions[i].food.nameId);
+            string_view unit = pooledString(topOptions[i].food.unitId);
+            cout << (i+1) << ") " << name 
+                 << " - " << topOptions[i].recommendedAmount << unit 
+                 << " (" << (int)topOptions[i].nutrientContributed << "g " << nutName << ")";
+            FoodUsage usage = getFoodUsage(p.username, string(name));
+            if (usage.count > 0) {
+                cout << " ⭐ you usually have " << (int)round(usage.typicalGrams) << unit;
+            }
+            cout << "\n";
         }
 
         cout << "\nSelect option to auto-add (0 to cancel): ";
@@ -0,0 +1,338 @@
+#include "reports.h"
+#include "filelock.h"
+#include "logstore.h"
+#include "projection.h"
+#include "recommendations.h"
+#include "trends.h"
+#include "utils.h"
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+// --- Fenwick tree ---
+
+// Prefix sums with O(log n) point updates and range queries.
+struct FenwickTree {
+    vector<int64_t> tree;   // 1-based
+
+    // Builds the tree from per-position values in O(n).
+    void build(const vector<int64_t>& values) {
+        tree.assign(values.size() + 1, 0);
+        for (size_t i = 1; i < tree.size(); ++i) {
+            tree[i] += values[i - 1];
+            size_t parent = i + (i & (~i + 1));
+            if (parent < tree.size()) tree[parent] += tree[i];
+        }
+    }
+
+    void add(size_t pos, int64_t delta) {
+        for (size_t i = pos + 1; i < tree.size(); i += i & (~i + 1)) tree[i] += delta;
+    }
+
+    // Sum of positions [0, count).
+    int64_t prefix(size_t count) const {
+        int64_t sum = 0;
+        for (size_t i = count; i > 0; i -= i & (~i + 1)) sum += tree[i];
+        return sum;
+    }
+
+    // Sum of positions [first, last].
+    int64_t range(size_t first, size_t last) const {
+        return prefix(last + 1) - prefix(first);
+    }
+};
+
+// --- Per-user day index ---
+
+struct DayIndex {
+    int baseDay = 0;                 // day number of position 0
+    vector<DayTotals> days;          // one slot per calendar day
+    FenwickTree sums[REPORT_NUTRIENTS];
+    FenwickTree entries;
+    FenwickTree logged;              // 1 for days with entries
+    FenwickTree over[REPORT_NUTRIENTS];
+    FenwickTree under[REPORT_NUTRIENTS];
+    int64_t targets[REPORT_NUTRIENTS] = {};   // fixed-point tenths
+    bool built = false;
+    uint64_t manifestGeneration = 0;          // logManifestGeneration when built
+    map<string, uint64_t> seenRecords;        // records folded in, per segment month
+};
+
+static map<string, DayIndex> dayIndexes;
+
+static int64_t nutrientTotal(const DayTotals& t, int n) {
+    switch (n) {
+        case REPORT_CALORIES: return t.calories;
+        case REPORT_PROTEIN: return t.protein;
+        case REPORT_CARBS: return t.carbs;
+        default: return t.fat;
+    }
+}
+
+// -1 under, 0 within tolerance (or no target / no entries), 1 over.
+static int targetStatus(const DayIndex& index, const DayTotals& t, int n) {
+    if (t.entries == 0 || index.targets[n] <= 0) return 0;
+    double total = (double)nutrientTotal(t, n);
+    double target = (double)index.targets[n];
+    if (total > target * (1.0 + REPORT_TARGET_TOLERANCE)) return 1;
+    if (total < target * (1.0 - REPORT_TARGET_TOLERANCE)) return -1;
+    return 0;
+}
+
+static void rebuildTargetTrees(DayIndex& index) {
+    vector<int64_t> overValues(index.days.size()), underValues(index.days.size());
+    for (int n = 0; n < REPORT_NUTRIENTS; ++n) {
+        for (size_t i = 0; i < index.days.size(); ++i) {
+            int status = targetStatus(index, index.days[i], n);
+            overValues[i] = (status > 0);
+            underValues[i] = (status < 0);
+        }
+        index.over[n].build(overValues);
+        index.under[n].build(underValues);
+    }
+}
+
+static void rebuildTrees(DayIndex& index) {
+    vector<int64_t> values(index.days.size());
+    for (int n = 0; n < REPORT_NUTRIENTS; ++n) {
+        for (size_t i = 0; i < index.days.size(); ++i) values[i] = nutrientTotal(index.days[i], n);
+        index.sums[n].build(values);
+    }
+    for (size_t i = 0; i < index.days.size(); ++i) values[i] = index.days[i].entries;
+    index.entries.build(values);
+    for (size_t i = 0; i < index.days.size(); ++i) values[i] = (index.days[i].entries > 0);
+    index.logged.build(values);
+    rebuildTargetTrees(index);
+}
+
+// Makes sure the index has a slot for day. Growing doubles the covered span,
+// so appending day after day rebuilds the trees only O(log n) times.
+static void ensureDaySlot(DayIndex& index, int day) {
+    int size = (int)index.days.size();
+    if (size > 0 && day >= index.baseDay && day < index.baseDay + size) return;
+
+    int first = (size == 0) ? day : min(index.baseDay, day);
+    int last = (size == 0) ? day : max(index.baseDay + size - 1, day);
+    int span = max(last - first + 1, 2 * size);
+    if (day < index.baseDay) first = last - span + 1;
+
+    vector<DayTotals> days(span);
+    for (int i = 0; i < size; ++i) days[index.baseDay - first + i] = index.days[i];
+    index.days.swap(days);
+    index.baseDay = first;
+    rebuildTrees(index);
+}
+
+static void addRecord(DayIndex& index, const LogRecord& r) {
+    ensureDaySlot(index, r.day);
+    size_t pos = (size_t)(r.day - index.baseDay);
+    DayTotals before = index.days[pos];
+    sumLogRecords(&r, 1, index.days[pos]);
+    const DayTotals& after = index.days[pos];
+
+    for (int n = 0; n < REPORT_NUTRIENTS; ++n) {
+        index.sums[n].add(pos, nutrientTotal(after, n) - nutrientTotal(before, n));
+        int oldStatus = targetStatus(index, before, n);
+        int newStatus = targetStatus(index, after, n);
+        if (oldStatus != newStatus) {
+            index.over[n].add(pos, (int64_t)(newStatus > 0) - (oldStatus > 0));
+            index.under[n].add(pos, (int64_t)(newStatus < 0) - (oldStatus < 0));
+        }
+    }
+    index.entries.add(pos, after.entries - before.entries);
+    if (before.entries == 0 && after.entries > 0) index.logged.add(pos, 1);
+    else if (before.entries > 0 && after.entries == 0) index.logged.add(pos, -1);   // last entry deleted
+}
+
+// Builds the index from the whole log.
+static void buildDayIndex(const string& username, const vector<LogSegment>& segments, DayIndex& index) {
+    int today = dateToDayNumber(getTodayDate());
+    int first = segments.empty() ? today : min(segments.front().firstDay, today);
+    int last = segments.empty() ? today : max(segments.back().lastDay, today);
+
+    index.baseDay = first;
+    index.days.assign(last - first + 1, DayTotals());
+    index.seenRecords.clear();
+    for (const LogSegment& seg : segments) {
+        vector<LogRecord> records;
+        index.seenRecords[seg.month] = readLogTail(username, seg, 0, records);
+        for (const LogRecord& r : records) {
+            ensureDaySlot(index, r.day);
+            sumLogRecords(&r, 1, index.days[r.day - index.baseDay]);
+        }
+    }
+    rebuildTrees(index);
+    index.built = true;
+}
+
+// Returns the user's index, brought up to date with the log. Records appended
+// since the last query, by this session or another one of the same user, are
+// read from the end of each open segment and added. When the manifest has
+// changed (compaction moves and folds records) the index is built again.
+// The user's shared lock keeps compaction out meanwhile.
+static DayIndex& dayIndexFor(const string& username) {
+    DayIndex& index = dayIndexes[username];
+    FileLock lock(userLockFile(username), LOCK_MODE_SHARED);
+    vector<LogSegment> segments = getLogSegments(username);
+    uint64_t generation = logManifestGeneration(username);
+    if (!index.built || index.manifestGeneration != generation) {
+        buildDayIndex(username, segments, index);
+        index.manifestGeneration = generation;
+        return index;
+    }
+
+    for (const LogSegment& seg : segments) {
+        if (seg.sealed) continue;
+        vector<LogRecord> records;
+        uint64_t& seen = index.seenRecords[seg.month];
+        seen = readLogTail(username, seg, seen, records);
+        for (const LogRecord& r : records) addRecord(index, r);
+    }
+    return index;
+}
+
+// Re-judges all days when the profile's targets have changed since the last query.
+static void applyTargets(DayIndex& index, const UserProfile& p) {
+    int64_t targets[REPORT_NUTRIENTS] = {
+        toFixed(p.dailyCaloriesTarget), toFixed(p.targetProtein_g),
+        toFixed(p.targetCarbs_g), toFixed(p.targetFat_g)
+    };
+    bool changed = false;
+    for (int n = 0; n < REPORT_NUTRIENTS; ++n) {
+        if (index.targets[n] != targets[n]) {
+            index.targets[n] = targets[n];
+            changed = true;
+        }
+    }
+    if (changed) rebuildTargetTrees(index);
+}
+
+// --- Public API ---
+
+RangeReport getRangeReport(const UserProfile& p, int firstDay, int lastDay) {
+    RangeReport report;
+    report.firstDay = firstDay;
+    report.lastDay = lastDay;
+
+    DayIndex& index = dayIndexFor(p.username);
+    applyTargets(index, p);
+
+    // Clip to the covered span; days outside it have no entries
+    int first = max(firstDay, index.baseDay);
+    int last = min(lastDay, index.baseDay + (int)index.days.size() - 1);
+    if (first > last) return report;
+    size_t a = (size_t)(first - index.baseDay);
+    size_t b = (size_t)(last - index.baseDay);
+
+    report.totals.calories = index.sums[REPORT_CALORIES].range(a, b);
+    report.totals.protein = index.sums[REPORT_PROTEIN].range(a, b);
+    report.totals.carbs = index.sums[REPORT_CARBS].range(a, b);
+    report.totals.fat = index.sums[REPORT_FAT].range(a, b);
+    report.totals.entries = (int32_t)index.entries.range(a, b);
+    report.loggedDays = (int)index.logged.range(a, b);
+    for (int n = 0; n < REPORT_NUTRIENTS; ++n) {
+        report.daysOver[n] = (int)index.over[n].range(a, b);
+        report.daysUnder[n] = (int)index.under[n].range(a, b);
+    }
+    return report;
+}
+
+// --- Display ---
+
+static void printReportLine(const string& label, int64_t total, int loggedDays, double target,
+                            int over, int under, const string& unit) {
+    double avg = loggedDays > 0 ? fromFixed(total) / loggedDays : 0.0;
+    cout << left << setw(12) << label
+         << setw(14) << (to_string((long long)llround(fromFixed(total))) + unit)
+         << setw(12) << (to_string((int)llround(avg)) + unit)
+         << setw(11) << (to_string((int)target) + unit)
+         << setw(7) << over << under << "\n";
+}
+
+static void printRangeReport(const UserProfile& p, const string& title, int firstDay, int lastDay) {
+    printHeader(title, dayNumberToDate(firstDay) + " to " + dayNumberToDate(lastDay));
+    RangeReport r = getRangeReport(p, firstDay, lastDay);
+
+    cout << "Days: " << (lastDay - firstDay + 1) << "   Days with entries: " << r.loggedDays
+         << "   Entries: " << r.totals.entries << "\n\n";
+    if (r.loggedDays == 0) {
+        cout << "No food was logged in this period.\n";
+        pauseConsole();
+        return;
+    }
+
+    cout << left << setw(12) << "Nutrient" << setw(14) << "Total" << setw(12) << "Avg/day"
+         << setw(11) << "Target" << setw(7) << "Over" << "Under" << "\n";
+    cout << "------------------------------------------------------------\n";
+    printReportLine("Calories", r.totals.calories, r.loggedDays, p.dailyCaloriesTarget,
+                    r.daysOver[REPORT_CALORIES], r.daysUnder[REPORT_CALORIES], "");
+    printReportLine("Protein", r.totals.protein, r.loggedDays, p.targetProtein_g,
+                    r.daysOver[REPORT_PROTEIN], r.daysUnder[REPORT_PROTEIN], "g");
+    printReportLine("Carbs", r.totals.carbs, r.loggedDays, p.targetCarbs_g,
+                    r.daysOver[REPORT_CARBS], r.daysUnder[REPORT_CARBS], "g");
+    printReportLine("Fat", r.totals.fat, r.loggedDays, p.targetFat_g,
+                    r.daysOver[REPORT_FAT], r.daysUnder[REPORT_FAT], "g");
+    cout << "\nAverages are per day with entries. Over/Under count days more than "
+         << (int)(REPORT_TARGET_TOLERANCE * 100) << "% away from target.\n";
+    pauseConsole();
+}
+
+// Asks for a "YYYY-MM-DD" date. Returns NO_DAY if the user goes back.
+static int promptDate(const string& prompt) {
+    while (true) {
+        cout << prompt;
+        string input;
+        getline(cin, input);
+        input = trim(input);
+        if (checkForBack(input)) return NO_DAY;
+        int day = dateToDayNumber(input);
+        if (day != NO_DAY) return day;
+        cout << "Please enter a date as YYYY-MM-DD (or 'b' to go back).\n";
+    }
+}
+
+void runHistoryReports(const UserProfile& p) {
+    while (true) {
+        printHeader("SUMMARIES & HISTORY REPORTS");
+        cout << "1. Today's summary (end of day)\n"
+             << "2. Last 7 days\n"
+             << "3. Last 30 days\n"
+             << "4. This month\n"
+             << "5. Custom date range\n"
+             << "6. Trends (7/30/90-day averages)\n"
+             << "7. Weight projection\n"
+             << "Choice (or 'b' to go back): ";
+        string choice;
+        getline(cin, choice);
+        choice = trim(choice);
+        if (checkForBack(choice)) return;
+
+        int today = dateToDayNumber(getTodayDate());
+        if (choice == "1") {
+            runEndDaySummary(p);
+        } else if (choice == "2") {
+            printRangeReport(p, "LAST 7 DAYS", today - 6, today);
+        } else if (choice == "3") {
+            printRangeReport(p, "LAST 30 DAYS", today - 29, today);
+        } else if (choice == "4") {
+            printRangeReport(p, "THIS MONTH", dateToDayNumber(monthOfDay(today) + "-01"), today);
+        } else if (choice == "5") {
+            int first = promptDate("From (YYYY-MM-DD): ");
+            if (first == NO_DAY) continue;
+            int last = promptDate("To (YYYY-MM-DD): ");
+            if (last == NO_DAY) continue;
+            if (last < first) swap(first, last);
+            printRangeReport(p, "DATE RANGE REPORT", first, last);
+        } else if (choice == "6") {
+            runTrendView(p);
+        } else if (choice == "7") {
+            runWeightProjection(p);
+        } else {
+            cout << "Please enter 1-7 (or 'b' to go back).\n";
+            pauseConsole();
+        }
+    }
+}
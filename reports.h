@@ -0,0 +1,45 @@
+#ifndef REPORTS_H
+#define REPORTS_H
+
+#include "models.h"
+#include <string>
+
+// Historical reports over arbitrary day ranges.
+//
+// Each user's daily totals are kept in memory as Fenwick (binary indexed)
+// trees over day numbers: one per nutrient sum, plus counts of logged days and
+// of days over/under target per nutrient. The trees are built from the log
+// once per session; each query first adds the records appended since (by any
+// session of the user), so any range query, even over ten years, costs
+// O(log n) per column plus the new records.
+
+enum ReportNutrient {
+    REPORT_CALORIES = 0,
+    REPORT_PROTEIN,
+    REPORT_CARBS,
+    REPORT_FAT,
+    REPORT_NUTRIENTS
+};
+
+// A day counts as over (under) target when its total is more than 5% above
+// (below) the target. Only days with at least one entry are counted.
+const double REPORT_TARGET_TOLERANCE = 0.05;
+
+struct RangeReport {
+    int firstDay = 0;
+    int lastDay = 0;
+    int loggedDays = 0;                    // days with at least one entry
+    DayTotals totals;                      // fixed-point sums (see LogRecord)
+    int daysOver[REPORT_NUTRIENTS] = {};
+    int daysUnder[REPORT_NUTRIENTS] = {};
+};
+
+// Totals and over/under counts for firstDay..lastDay (inclusive), judged
+// against the profile's current targets.
+RangeReport getRangeReport(const UserProfile& p, int firstDay, int lastDay);
+
+// Dashboard option 7: today's summary, weekly/monthly and custom range
+// reports, and the rolling trends (trends.h).
+void runHistoryReports(const UserProfile& p);
+
+#endif
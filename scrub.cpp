@@ -0,0 +1,248 @@
+#include "scrub.h"
+#include "catalog.h"
+#include "checksum.h"
+#include "filelock.h"
+#include "logstore.h"
+#include "profilestore.h"
+#include "userdirs.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const uint32_t scrubProfileRecords = 65536;   // profile records per item
+
+enum ScrubKind {
+    SCRUB_USER,
+    SCRUB_PROFILES,
+    SCRUB_CATALOG
+};
+
+struct ScrubItem {
+    ScrubKind kind = SCRUB_USER;
+    string name;          // username, or the file
+    uint32_t first = 0;   // SCRUB_PROFILES: first record
+};
+
+// Data read without a checksum, of one kind.
+struct Uncovered {
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+};
+
+// What one item (or, merged, the whole scrub) found.
+struct ScrubResult {
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+    uint64_t checkedBytes = 0;
+    vector<string> problems;             // "file: what is wrong"
+    map<string, Uncovered> uncovered;    // by kind, e.g. "usage.txt"
+};
+
+static void addUncovered(ScrubResult& result, const string& kind, uint64_t bytes) {
+    Uncovered& u = result.uncovered[kind];
+    u.files++;
+    u.bytes += bytes;
+}
+
+// uncoveredKind names the part of the file a checksum did not cover.
+static void addCheck(ScrubResult& result, const string& filename, const FileCheck& check, bool ok,
+                     const string& uncoveredKind) {
+    result.files++;
+    result.bytes += check.bytes;
+    result.checkedBytes += check.checkedBytes;
+    if (!ok) result.problems.push_back(filename + ": " + check.problem);
+    else if (check.bytes > check.checkedBytes) addUncovered(result, uncoveredKind, check.bytes - check.checkedBytes);
+}
+
+// A file with no checksums at all: counted, but only as uncovered.
+static void addUnchecked(ScrubResult& result, const string& filename, const string& kind) {
+    error_code ec;
+    uintmax_t bytes = filesystem::file_size(filename, ec);
+    if (ec) return;
+    result.files++;
+    result.bytes += bytes;
+    addUncovered(result, kind, bytes);
+}
+
+// --- Items ---
+
+// The log segments in the manifest and the custom foods file are checked;
+// every other file of the directory (usage, trends, weight, meals, recipes,
+// the manifest itself...) has no checksums and is listed as uncovered.
+static void scrubUser(const string& username, ScrubResult& result) {
+    FileLock lock(userLockFile(username), LOCK_MODE_SHARED);
+    vector<string> checked;
+    vector<LogSegment> segments;
+    if (readLogManifest(username, segments)) {
+        for (const LogSegment& seg : segments) {
+            string filename = logSegmentFileName(username, seg.month);
+            FileCheck check;
+            addCheck(result, filename, check, verifyLogSegment(filename, seg, check),
+                     "log records appended since the last compaction");
+            checked.push_back(filename);
+        }
+    }
+
+    error_code ec;
+    string customFile = userFilePath(username, "custom_foods.txt");
+    if (filesystem::exists(customFile, ec)) {
+        FileCheck check;
+        addCheck(result, customFile, check, verifyFoodFile(customFile, check), "custom_foods.txt lines without a checksum");
+        checked.push_back(customFile);
+    }
+
+    string lockFile = userLockFile(username);
+    filesystem::path dir = filesystem::path(lockFile).parent_path();
+    for (filesystem::directory_iterator f(dir, ec), end; !ec && f != end; f.increment(ec)) {
+        if (!f->is_regular_file()) continue;
+        string filename = f->path().string();
+        if (filename == lockFile || find(checked.begin(), checked.end(), filename) != checked.end()) continue;
+        string name = f->path().filename().string();
+        addUnchecked(result, filename, name.rfind("log_", 0) == 0 && name != "log_manifest.txt" ? "log segments not in the manifest" : name);
+    }
+}
+
+static void scrubProfiles(uint32_t first, ScrubResult& result) {
+    vector<uint32_t> damaged;
+    uint32_t checked = 0;
+    uint32_t n = verifyProfileRecords(first, scrubProfileRecords, damaged, &checked);
+    result.bytes += (uint64_t)n * sizeof(ProfileRecord);
+    result.checkedBytes += (uint64_t)checked * sizeof(ProfileRecord);
+    for (uint32_t id : damaged) {
+        result.problems.push_back(string(PROFILE_STORE_FILE) + ": checksum mismatch in record " + to_string(id));
+    }
+}
+
+static void scrubItem(const ScrubItem& item, ScrubResult& result) {
+    if (item.kind == SCRUB_USER) {
+        scrubUser(item.name, result);
+    } else if (item.kind == SCRUB_PROFILES) {
+        scrubProfiles(item.first, result);
+    } else {
+        FileCheck check;
+        addCheck(result, item.name, check, verifyFoodFile(item.name, check), item.name + " lines without a checksum");
+    }
+}
+
+// Every user directory (data/ab/cd/USERNAME/), the profile store in ranges
+// and foods.txt. Problems found while listing (the profile store's header or
+// a half-written last record) go to result, and so do the shared files that
+// have no checksums.
+static void listItems(vector<ScrubItem>& items, ScrubResult& result) {
+    error_code ec;
+    for (filesystem::directory_iterator a(USER_DATA_ROOT, ec), end; !ec && a != end; a.increment(ec)) {
+        if (!a->is_directory()) continue;
+        for (filesystem::directory_iterator b(a->path(), ec); !ec && b != end; b.increment(ec)) {
+            if (!b->is_directory()) continue;
+            for (filesystem::directory_iterator u(b->path(), ec); !ec && u != end; u.increment(ec)) {
+                if (!u->is_directory()) continue;
+                ScrubItem item;
+                item.name = u->path().filename().string();
+                items.push_back(item);
+            }
+            ec.clear();
+        }
+        ec.clear();
+    }
+
+    uintmax_t bytes = filesystem::file_size(PROFILE_STORE_FILE, ec);
+    if (!ec) {
+        result.files++;
+        result.bytes += min<uintmax_t>(bytes, PROFILE_HEADER_BYTES);
+        uintmax_t recordBytes = bytes > PROFILE_HEADER_BYTES ? bytes - PROFILE_HEADER_BYTES : 0;
+        uint32_t count = (uint32_t)(recordBytes / sizeof(ProfileRecord));
+        vector<uint32_t> none;
+        if (bytes < PROFILE_HEADER_BYTES || (count > 0 && verifyProfileRecords(0, 1, none) == 0)) {
+            result.problems.push_back(string(PROFILE_STORE_FILE) + ": not a profile store");
+            count = 0;
+        } else if (recordBytes % sizeof(ProfileRecord) != 0) {
+            result.bytes += recordBytes % sizeof(ProfileRecord);
+            result.problems.push_back(string(PROFILE_STORE_FILE) + ": ends in a record left half written");
+        }
+        for (uint32_t first = 0; first < count; first += scrubProfileRecords) {
+            ScrubItem item;
+            item.kind = SCRUB_PROFILES;
+            item.first = first;
+            items.push_back(item);
+        }
+    }
+    ec.clear();
+
+    if (filesystem::exists("foods.txt", ec)) {
+        ScrubItem item;
+        item.kind = SCRUB_CATALOG;
+        item.name = "foods.txt";
+        items.push_back(item);
+    }
+
+    for (const char* name : {"users.txt", "food_ids.txt"}) addUnchecked(result, name, name);
+}
+
+bool runScrub(ostream& out, int threads) {
+    auto start = chrono::steady_clock::now();
+    ScrubResult total;
+    vector<ScrubItem> items;
+    listItems(items, total);
+
+    // Each worker takes the next unchecked item; results are kept per item so
+    // they can be printed in order
+    size_t workers = threads > 0 ? (size_t)threads : max(1u, thread::hardware_concurrency());
+    workers = max<size_t>(1, min(workers, items.size()));
+    vector<ScrubResult> results(items.size());
+    atomic<size_t> nextItem(0);
+    auto worker = [&]() {
+        for (size_t i = nextItem++; i < items.size(); i = nextItem++) scrubItem(items[i], results[i]);
+    };
+    if (workers == 1) {
+        worker();
+    } else {
+        vector<thread> pool;
+        for (size_t t = 0; t < workers; ++t) pool.push_back(thread(worker));
+        for (thread& t : pool) t.join();
+    }
+
+    for (const ScrubResult& r : results) {
+        total.files += r.files;
+        total.bytes += r.bytes;
+        total.checkedBytes += r.checkedBytes;
+        total.problems.insert(total.problems.end(), r.problems.begin(), r.problems.end());
+        for (const auto& u : r.uncovered) {
+            total.uncovered[u.first].files += u.second.files;
+            total.uncovered[u.first].bytes += u.second.bytes;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    out << "SCRUB\n\n";
+    for (const string& problem : total.problems) out << "  DAMAGED " << problem << "\n";
+    if (!total.problems.empty()) out << "\n";
+    out << fixed << setprecision(1);
+    out << left << setw(18) << "Files:" << total.files << "\n";
+    out << left << setw(18) << "Data:" << total.bytes / 1048576.0 << " MB, "
+        << (total.bytes > 0 ? total.checkedBytes * 100.0 / total.bytes : 100.0) << "% covered by checksums\n";
+    out << left << setw(18) << "Damaged:" << total.problems.size() << "\n";
+    out << left << setw(18) << "CRC32C:" << (crc32cHardware() ? "SSE4.2" : "table") << "\n";
+    if (!total.uncovered.empty()) {
+        out << "\nNot covered by checksums (read, but damage there is not found):\n";
+        for (const auto& u : total.uncovered) {
+            out << "  " << left << setw(48) << u.first << right << setw(7) << u.second.files << " file(s) "
+                << setw(10) << u.second.bytes / 1024.0 << " KB\n";
+        }
+        out << left;
+    }
+    out << setprecision(3);
+    out << "\nChecked on " << workers << " thread(s) in " << seconds * 1000.0 << " ms";
+    if (seconds > 0) out << " (" << setprecision(1) << total.bytes / 1048576.0 / seconds << " MB/s)";
+    out << ".\n";
+    out.unsetf(ios::fixed);
+    out << setprecision(6);
+    return total.problems.empty();
+}
@@ -0,0 +1,28 @@
+#ifndef SCRUB_H
+#define SCRUB_H
+
+#include <iostream>
+
+// Scrub: checks every stored file of the data directory against its checksums
+// (checksum.h) instead of waiting for a read to come across the damage.
+//
+// The work is cut into items: one per user directory (the log segments
+// listed in the manifest and the custom foods file), one per range of
+// profile records, and foods.txt. A pool of worker threads takes the next
+// unchecked item until none are left, so one user with a long history does
+// not hold the others up. A user's directory is checked under the user's
+// shared lock (filelock.h), so sessions may keep running meanwhile.
+//
+// Only log segments, profile records and food lines carry checksums. Records
+// appended to an open log segment since its last compaction, food lines
+// without a checksum (all of foods.txt as shipped) and the files with no
+// checksums at all (usage, trends, weight, meals, recipes, projection, the
+// log manifest, profile_id.txt, users.txt, food_ids.txt) are not checked;
+// the summary lists them by kind with their size, and shows how much of the
+// data a checksum covered.
+
+// "--scrub [threads]": checks everything and prints each damaged file and a
+// summary. threads <= 0 uses one per CPU. Returns false if anything is damaged.
+bool runScrub(std::ostream& out, int threads);
+
+#endif
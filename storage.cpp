@@ -0,0 +1,481 @@
+#include "storage.h"
+#include "catalog.h"
+#include "foodids.h"
+#include "logstore.h"
+#include "profilestore.h"
+#include "targets.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#ifdef WITH_SQLITE
+#include <sqlite3.h>
+#endif
+
+using namespace std;
+
+// --- Text engine ---
+
+static void writeProfileBlock(ostream& out, const UserProfile& p) {
+    out << "USER_PROFILE\n"
+        << "Name: " << p.fullName() << "\n"
+        << "Age: " << p.age << "\n"
+        << "Gender: " << GENDER_NAMES[p.gender] << "\n"
+        << "Height: " << p.height_cm << "\n"
+        << "Weight: " << p.weight_kg << "\n"
+        << "Activity_Level: " << ACTIVITY_LEVEL_NAMES[p.activityLevel] << "\n"
+        << "Daily_Calorie_Target: " << p.dailyCaloriesTarget << "\n"
+        << "Body_Fat: " << p.bodyFatPercent << "\n"
+        << "BMR_Formula: " << BMR_FORMULA_NAMES[p.bmrFormula] << "\n"
+        << "Macro_Strategy: " << MACRO_SPLITS[p.macroStrategy].name << "\n\n";
+}
+
+class TextStorage : public StorageEngine {
+public:
+    const char* name() const override { return "text"; }
+
+    // The block is replaced and the rest of the file (the log) copied behind it
+    bool saveProfile(UserProfile& p) override {
+        ensureUserDir(p.username);
+        string filename = userFilePath(p.username, "data.txt");
+        string rest, line;
+        {
+            ifstream in(filename);
+            bool inProfile = false;
+            while (getline(in, line)) {
+                if (line == "USER_PROFILE") { inProfile = true; continue; }
+                if (inProfile) { inProfile = !line.empty(); continue; }
+                rest += line;
+                rest += '\n';
+            }
+        }
+        string tmp = filename + ".tmp";
+        {
+            ofstream out(tmp, ios::trunc);
+            writeProfileBlock(out, p);
+            out << rest;
+            if (!out) return false;
+        }
+        return rename(tmp.c_str(), filename.c_str()) == 0;
+    }
+
+    bool loadProfile(const string& username, UserProfile& p) override {
+        ifstream in(userFilePath(username, "data.txt"));
+        return in && readProfileBlock(in, username, p);
+    }
+
+    bool appendEntries(const string& username, const vector<LogRecord>& records) override {
+        ensureUserDir(username);
+        ofstream out(userFilePath(username, "data.txt"), ios::app);
+        if (!out) return false;
+        out << fixed << setprecision(1);
+        int currentDay = NO_DAY;
+        for (const LogRecord& r : records) {
+            if (r.flags != 0) return false;
+            if (r.day != currentDay) {
+                if (currentDay != NO_DAY) out << "END_DAILY_LOG\n\n";
+                out << "DAILY_LOG\n" << "Date: " << dayNumberToDate(r.day) << "\n";
+                currentDay = r.day;
+            }
+            FoodItem food;
+            FoodRef ref;
+            ref.id = r.foodId;
+            ref.rev = r.foodRev;
+            string name = resolveFood(username, ref, food) ? string(food.name()) : "Unknown food";
+            out << "Type: " << mealTypeName(r.mealType) << "\n"
+                << name << " | " << fromFixed(r.calories) << " | " << fromFixed(r.protein) << " | "
+                << fromFixed(r.carbs) << " | " << fromFixed(r.fat) << " | " << fromFixed(r.grams) << "\n";
+        }
+        if (currentDay != NO_DAY) out << "END_DAILY_LOG\n\n";
+        return (bool)out;
+    }
+
+    bool dayTotals(const string& username, int day, DayTotals& totals) override {
+        totals = DayTotals();
+        ifstream in(userFilePath(username, "data.txt"));
+        if (!in) return false;
+        string line;
+        int currentDay = NO_DAY;
+        while (getline(in, line)) {
+            string t = trim(line);
+            if (t.rfind("Date:", 0) == 0) { currentDay = dateToDayNumber(t.substr(5)); continue; }
+            LoggedFood food;
+            if (currentDay != day || !parseLogEntryLine(username, t, food)) continue;
+            totals.calories += toFixed(food.calories);
+            totals.protein += toFixed(food.protein);
+            totals.carbs += toFixed(food.carbs);
+            totals.fat += toFixed(food.fat);
+            totals.entries++;
+        }
+        return true;
+    }
+
+    bool addCustomFood(const string& username, const FoodItem& food) override {
+        ensureUserDir(username);
+        ofstream out(userFilePath(username, "custom_foods.txt"), ios::app);
+        out << formatFoodRecord(food) << "\n";
+        return (bool)out;
+    }
+
+    bool loadCustomFoods(const string& username, vector<FoodItem>& foods) override {
+        foods.clear();
+        ifstream in(userFilePath(username, "custom_foods.txt"));
+        string line;
+        while (getline(in, line)) {
+            FoodItem item;
+            if (!parseFoodRecord(line, item)) continue;
+            item.isCustom = true;
+            foods.push_back(item);
+        }
+        return true;
+    }
+};
+
+// --- Binary engine ---
+
+class BinaryStorage : public StorageEngine {
+public:
+    const char* name() const override { return "binary"; }
+
+    bool saveProfile(UserProfile& p) override {
+        return writeProfile(p);
+    }
+
+    bool loadProfile(const string& username, UserProfile& p) override {
+        uint32_t id = findUserId(username);
+        return id != NO_USER_ID && readProfile(id, p);
+    }
+
+    bool appendEntries(const string& username, const vector<LogRecord>& records) override {
+        return logRecords(username, records);
+    }
+
+    bool dayTotals(const string& username, int day, DayTotals& totals) override {
+        totals = getDayTotals(username, day);
+        return true;
+    }
+
+    bool addCustomFood(const string& username, const FoodItem& food) override {
+        return ::addCustomFood(username, food);
+    }
+
+    bool loadCustomFoods(const string& username, vector<FoodItem>& foods) override {
+        foods = getCustomOverlay(username).foods;
+        return true;
+    }
+};
+
+// --- SQLite engine ---
+
+#ifdef WITH_SQLITE
+static const char* const sqliteSchema =
+    "PRAGMA journal_mode=WAL;"
+    "PRAGMA synchronous=NORMAL;"
+    "CREATE TABLE IF NOT EXISTS profiles (username TEXT PRIMARY KEY, full_name TEXT, age INTEGER,"
+    " gender INTEGER, height_cm INTEGER, weight_kg REAL, body_fat REAL, activity INTEGER,"
+    " bmr_formula INTEGER, macro_strategy INTEGER, calorie_target REAL);"
+    "CREATE TABLE IF NOT EXISTS log_entries (username TEXT, day INTEGER, food_id INTEGER,"
+    " food_rev INTEGER, meal INTEGER, flags INTEGER, grams INTEGER, calories INTEGER,"
+    " protein INTEGER, carbs INTEGER, fat INTEGER);"
+    "CREATE INDEX IF NOT EXISTS log_by_day ON log_entries (username, day);"
+    "CREATE TABLE IF NOT EXISTS custom_foods (username TEXT, name TEXT, calories REAL, protein REAL,"
+    " carbs REAL, fat REAL, serving REAL, PRIMARY KEY (username, name));";
+
+class SqliteStorage : public StorageEngine {
+public:
+    ~SqliteStorage() override {
+        for (sqlite3_stmt* s : { putProfile, getProfile, putEntry, sumDay, putFood, getFoods }) sqlite3_finalize(s);
+        sqlite3_close(db);
+    }
+
+    bool open(const string& filename) {
+        if (sqlite3_open(filename.c_str(), &db) != SQLITE_OK) return false;
+        if (sqlite3_exec(db, sqliteSchema, nullptr, nullptr, nullptr) != SQLITE_OK) return false;
+        return prepare("INSERT OR REPLACE INTO profiles VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11)", putProfile)
+            && prepare("SELECT full_name, age, gender, height_cm, weight_kg, body_fat, activity, bmr_formula,"
+                       " macro_strategy, calorie_target FROM profiles WHERE username = ?1", getProfile)
+            && prepare("INSERT INTO log_entries VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11)", putEntry)
+            && prepare("SELECT SUM(calories), SUM(protein), SUM(carbs), SUM(fat),"
+                       " SUM(CASE WHEN flags & 1 THEN -1 ELSE 1 END) FROM log_entries WHERE username = ?1 AND day = ?2", sumDay)
+            && prepare("INSERT OR REPLACE INTO custom_foods VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)", putFood)
+            && prepare("SELECT name, calories, protein, carbs, fat, serving FROM custom_foods WHERE username = ?1", getFoods);
+    }
+
+    const char* name() const override { return "sqlite"; }
+
+    bool saveProfile(UserProfile& p) override {
+        string fullName(p.fullName());
+        sqlite3_reset(putProfile);
+        sqlite3_bind_text(putProfile, 1, p.username.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(putProfile, 2, fullName.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(putProfile, 3, p.age);
+        sqlite3_bind_int(putProfile, 4, p.gender);
+        sqlite3_bind_int(putProfile, 5, p.height_cm);
+        sqlite3_bind_double(putProfile, 6, p.weight_kg);
+        sqlite3_bind_double(putProfile, 7, p.bodyFatPercent);
+        sqlite3_bind_int(putProfile, 8, p.activityLevel);
+        sqlite3_bind_int(putProfile, 9, p.bmrFormula);
+        sqlite3_bind_int(putProfile, 10, p.macroStrategy);
+        sqlite3_bind_double(putProfile, 11, p.dailyCaloriesTarget);
+        return sqlite3_step(putProfile) == SQLITE_DONE;
+    }
+
+    bool loadProfile(const string& username, UserProfile& p) override {
+        sqlite3_reset(getProfile);
+        sqlite3_bind_text(getProfile, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(getProfile) != SQLITE_ROW) return false;
+        p.username = username;
+        p.fullNameId = internString((const char*)sqlite3_column_text(getProfile, 0));
+        p.age = (uint16_t)sqlite3_column_int(getProfile, 1);
+        p.gender = (Gender)(sqlite3_column_int(getProfile, 2) % GENDERS);
+        p.height_cm = (uint16_t)sqlite3_column_int(getProfile, 3);
+        p.weight_kg = (float)sqlite3_column_double(getProfile, 4);
+        p.bodyFatPercent = (float)sqlite3_column_double(getProfile, 5);
+        p.activityLevel = (ActivityLevel)(sqlite3_column_int(getProfile, 6) % ACTIVITY_LEVELS);
+        p.bmrFormula = (BmrFormula)(sqlite3_column_int(getProfile, 7) % BMR_FORMULAS);
+        p.macroStrategy = (MacroStrategy)(sqlite3_column_int(getProfile, 8) % MACRO_STRATEGIES);
+        p.dailyCaloriesTarget = sqlite3_column_double(getProfile, 9);
+        return true;
+    }
+
+    bool appendEntries(const string& username, const vector<LogRecord>& records) override {
+        if (sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr) != SQLITE_OK) return false;
+        bool ok = true;
+        for (const LogRecord& r : records) {
+            sqlite3_reset(putEntry);
+            sqlite3_bind_text(putEntry, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(putEntry, 2, r.day);
+            sqlite3_bind_int64(putEntry, 3, r.foodId);
+            sqlite3_bind_int(putEntry, 4, r.foodRev);
+            sqlite3_bind_int(putEntry, 5, r.mealType);
+            sqlite3_bind_int(putEntry, 6, r.flags);
+            sqlite3_bind_int(putEntry, 7, r.grams);
+            sqlite3_bind_int(putEntry, 8, r.calories);
+            sqlite3_bind_int(putEntry, 9, r.protein);
+            sqlite3_bind_int(putEntry, 10, r.carbs);
+            sqlite3_bind_int(putEntry, 11, r.fat);
+            if (sqlite3_step(putEntry) != SQLITE_DONE) { ok = false; break; }
+        }
+        return sqlite3_exec(db, ok ? "COMMIT" : "ROLLBACK", nullptr, nullptr, nullptr) == SQLITE_OK && ok;
+    }
+
+    bool dayTotals(const string& username, int day, DayTotals& totals) override {
+        sqlite3_reset(sumDay);
+        sqlite3_bind_text(sumDay, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(sumDay, 2, day);
+        if (sqlite3_step(sumDay) != SQLITE_ROW) return false;
+        totals.calories = sqlite3_column_int64(sumDay, 0);
+        totals.protein = sqlite3_column_int64(sumDay, 1);
+        totals.carbs = sqlite3_column_int64(sumDay, 2);
+        totals.fat = sqlite3_column_int64(sumDay, 3);
+        totals.entries = sqlite3_column_int(sumDay, 4);
+        return true;
+    }
+
+    bool addCustomFood(const string& username, const FoodItem& food) override {
+        string name(food.name());
+        sqlite3_reset(putFood);
+        sqlite3_bind_text(putFood, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(putFood, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(putFood, 3, food.calories);
+        sqlite3_bind_double(putFood, 4, food.protein);
+        sqlite3_bind_double(putFood, 5, food.carbs);
+        sqlite3_bind_double(putFood, 6, food.fat);
+        sqlite3_bind_double(putFood, 7, food.servingSize);
+        return sqlite3_step(putFood) == SQLITE_DONE;
+    }
+
+    bool loadCustomFoods(const string& username, vector<FoodItem>& foods) override {
+        foods.clear();
+        sqlite3_reset(getFoods);
+        sqlite3_bind_text(getFoods, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(getFoods) == SQLITE_ROW) {
+            FoodItem item;
+            setFoodName(item, (const char*)sqlite3_column_text(getFoods, 0));
+            item.calories = (float)sqlite3_column_double(getFoods, 1);
+            item.protein = (float)sqlite3_column_double(getFoods, 2);
+            item.carbs = (float)sqlite3_column_double(getFoods, 3);
+            item.fat = (float)sqlite3_column_double(getFoods, 4);
+            item.servingSize = (float)sqlite3_column_double(getFoods, 5);
+            item.isCustom = true;
+            foods.push_back(item);
+        }
+        return true;
+    }
+
+private:
+    bool prepare(const char* sql, sqlite3_stmt*& stmt) {
+        return sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK;
+    }
+
+    sqlite3* db = nullptr;
+    sqlite3_stmt* putProfile = nullptr;
+    sqlite3_stmt* getProfile = nullptr;
+    sqlite3_stmt* putEntry = nullptr;
+    sqlite3_stmt* sumDay = nullptr;
+    sqlite3_stmt* putFood = nullptr;
+    sqlite3_stmt* getFoods = nullptr;
+};
+#endif
+
+unique_ptr<StorageEngine> makeStorageEngine(const string& name) {
+    if (name == "text") return unique_ptr<StorageEngine>(new TextStorage());
+    if (name == "binary") return unique_ptr<StorageEngine>(new BinaryStorage());
+#ifdef WITH_SQLITE
+    if (name == "sqlite") {
+        unique_ptr<SqliteStorage> engine(new SqliteStorage());
+        if (engine->open("nutrition.db")) return unique_ptr<StorageEngine>(engine.release());
+    }
+#endif
+    return nullptr;
+}
+
+// --- Benchmark ---
+
+static const int benchFoods = 40;
+static const int benchEntriesPerDay = 4;
+static const int benchCustomFoods = 5;
+static const char* const benchEngines[] = { "text", "binary", "sqlite" };
+
+// Times and the values read back, which must agree between engines.
+struct BenchResult {
+    double profileMs = 0.0, appendMs = 0.0, totalsMs = 0.0, foodsMs = 0.0;
+    int64_t calories = 0;   // sum of every day's totals
+    size_t foods = 0;       // custom foods read back
+    size_t profiles = 0;    // profiles read back
+    bool ok = true;
+};
+
+static double msSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static UserProfile benchProfile(int u) {
+    UserProfile p;
+    p.username = "bench" + to_string(u);
+    p.fullNameId = internString("Bench User");
+    p.age = (uint16_t)(20 + u % 50);
+    p.height_cm = (uint16_t)(150 + u % 40);
+    p.weight_kg = (float)(50 + u % 50);
+    p.bodyFatPercent = 20.0f;
+    p.gender = (Gender)(u % GENDERS);
+    p.activityLevel = (ActivityLevel)(u % ACTIVITY_LEVELS);
+    p.bmrFormula = (BmrFormula)(u % BMR_FORMULAS);
+    p.macroStrategy = (MacroStrategy)(u % MACRO_STRATEGIES);
+    p.dailyCaloriesTarget = 1800 + u % 700;
+    return p;
+}
+
+static BenchResult runWorkload(StorageEngine& engine, int users, int firstDay, int days,
+                               const vector<FoodItem>& foods, const vector<FoodRef>& refs) {
+    BenchResult res;
+    auto start = chrono::steady_clock::now();
+    for (int u = 0; u < users; ++u) {
+        UserProfile p = benchProfile(u);
+        res.ok &= engine.saveProfile(p);
+        p.weight_kg -= 1.0f;
+        res.ok &= engine.saveProfile(p);
+    }
+    res.profileMs = msSince(start);
+
+    start = chrono::steady_clock::now();
+    vector<LogRecord> records;
+    for (int u = 0; u < users; ++u) {
+        string username = "bench" + to_string(u);
+        for (int d = 0; d < days; ++d) {
+            records.clear();
+            for (int k = 0; k < benchEntriesPerDay; ++k) {
+                int f = (u * 7 + d * benchEntriesPerDay + k) % benchFoods;
+                records.push_back(makeLogRecord(refs[f], foods[f], 50 + (d + k) % 5 * 50, (MealType)(1 + k), firstDay + d));
+            }
+            res.ok &= engine.appendEntries(username, records);
+        }
+    }
+    res.appendMs = msSince(start);
+
+    start = chrono::steady_clock::now();
+    for (int u = 0; u < users; ++u) {
+        string username = "bench" + to_string(u);
+        for (int d = 0; d < days; ++d) {
+            DayTotals t;
+            res.ok &= engine.dayTotals(username, firstDay + d, t);
+            res.calories += t.calories;
+        }
+    }
+    res.totalsMs = msSince(start);
+
+    start = chrono::steady_clock::now();
+    vector<FoodItem> loaded;
+    for (int u = 0; u < users; ++u) {
+        string username = "bench" + to_string(u);
+        for (int k = 0; k < benchCustomFoods; ++k) {
+            FoodItem item = foods[(u + k) % benchFoods];
+            setFoodName(item, "Custom " + to_string(k));
+            item.isCustom = true;
+            res.ok &= engine.addCustomFood(username, item);
+        }
+        res.ok &= engine.loadCustomFoods(username, loaded);
+        res.foods += loaded.size();
+        UserProfile p;
+        if (engine.loadProfile(username, p)) res.profiles++;
+    }
+    res.foodsMs = msSince(start);
+    return res;
+}
+
+void runStorageBenchmark(ostream& out, int users, int days) {
+    users = max(users, 1);
+    days = max(days, 1);
+    error_code ec;
+    filesystem::path home = filesystem::current_path();
+    filesystem::path root = home / "storage_bench";
+    filesystem::remove_all(root, ec);
+    filesystem::create_directories(root, ec);
+    filesystem::current_path(root, ec);
+    if (ec) {
+        out << "Could not create " << root.string() << ".\n";
+        return;
+    }
+
+    // Shared foods registered once, so every engine logs the same references
+    vector<FoodItem> foods(benchFoods);
+    vector<FoodRef> refs(benchFoods);
+    for (int f = 0; f < benchFoods; ++f) {
+        setFoodName(foods[f], "Bench food " + to_string(f));
+        foods[f].calories = (float)(50 + f * 10);
+        foods[f].protein = (float)(f % 20);
+        foods[f].carbs = (float)(f % 30);
+        foods[f].fat = (float)(f % 10);
+        refs[f] = registerFood("", foods[f]);
+    }
+    int firstDay = dateToDayNumber(getTodayDate()) - days;
+
+    out << "STORAGE BENCHMARK: " << users << " user(s), " << days << " day(s) of " << benchEntriesPerDay
+        << " entries each\n\n";
+    out << left << setw(8) << "Engine" << right << setw(12) << "Profiles" << setw(12) << "Append"
+        << setw(12) << "Day totals" << setw(14) << "Foods+reads" << setw(12) << "Total" << "   kcal read\n";
+    out << fixed << setprecision(1);
+    for (const char* name : benchEngines) {
+        filesystem::create_directories(root / name, ec);
+        filesystem::current_path(root / name, ec);
+        unique_ptr<StorageEngine> engine = makeStorageEngine(name);
+        if (!engine) {
+            out << left << setw(8) << name << "   not built (compile with -DWITH_SQLITE, link -lsqlite3)\n";
+            continue;
+        }
+        BenchResult r = runWorkload(*engine, users, firstDay, days, foods, refs);
+        out << left << setw(8) << name << right << setw(12) << r.profileMs << setw(12) << r.appendMs
+            << setw(12) << r.totalsMs << setw(14) << r.foodsMs
+            << setw(12) << r.profileMs + r.appendMs + r.totalsMs + r.foodsMs << "   " << fromFixed(r.calories);
+        if (!r.ok || r.profiles != (size_t)users || r.foods != (size_t)users * benchCustomFoods) out << "  (errors)";
+        out << "\n";
+    }
+    out << "\nTimes in ms.\n";
+    out.unsetf(ios::fixed);
+
+    filesystem::current_path(home, ec);
+    filesystem::remove_all(root, ec);
+}
@@ -0,0 +1,58 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "models.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Storage engines: one interface over the per-user data (profiles, log
+// entries and the day totals read from them, custom foods) with
+// interchangeable on-disk formats.
+//
+//   text    the original text format: the USER_PROFILE and DAILY_LOG blocks
+//           of data.txt ("name | cal | protein | carbs | fat | grams" lines)
+//           and custom_foods.txt. Saving a profile rewrites the whole file;
+//           a day's totals are found by parsing all of it.
+//   binary  the stores the application uses: profiles.dat (profilestore.h),
+//           the monthly log segments (logstore.h) and the custom food
+//           overlay (catalog.h). Its appends also update the usage table and
+//           the trends, as logging in the application does.
+//   sqlite  one SQLite database (nutrition.db) with prepared statements and
+//           an index on (user, day). Only built with -DWITH_SQLITE (link with
+//           -lsqlite3).
+//
+// Engines work on files relative to the working directory, like the rest of
+// the application. The text engine stores plain entries only: corrections
+// (LOG_FLAG_TOMBSTONE / LOG_FLAG_REPLACEMENT) are rejected.
+class StorageEngine {
+public:
+    virtual ~StorageEngine() {}
+
+    virtual const char* name() const = 0;
+
+    // Creates or replaces the user's profile (the username is the key).
+    virtual bool saveProfile(UserProfile& p) = 0;
+    virtual bool loadProfile(const std::string& username, UserProfile& p) = 0;
+
+    // Appends log records in one write (one transaction for SQLite).
+    virtual bool appendEntries(const std::string& username, const std::vector<LogRecord>& records) = 0;
+    virtual bool dayTotals(const std::string& username, int day, DayTotals& totals) = 0;
+
+    virtual bool addCustomFood(const std::string& username, const FoodItem& food) = 0;
+    virtual bool loadCustomFoods(const std::string& username, std::vector<FoodItem>& foods) = 0;
+};
+
+// The engine with that name ("text", "binary", "sqlite"), or nullptr if it is
+// unknown or not built in.
+std::unique_ptr<StorageEngine> makeStorageEngine(const std::string& name);
+
+// "--storage-benchmark [users] [days]": runs the same workload (profiles
+// created and updated, days of entries appended, every day's totals read
+// back, custom foods added and loaded) on every engine, each in its own
+// directory under storage_bench/, and prints the time per phase. The
+// directory is removed afterwards.
+void runStorageBenchmark(std::ostream& out, int users, int days);
+
+#endif
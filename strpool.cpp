@@ -0,0 +1,103 @@
+#include "strpool.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+// --- Layout ---
+// An ID is (index << shardBits) | shard. Each shard owns:
+//  - arena blocks holding the characters,
+//  - a hash map from string to ID used only while interning (under the lock),
+//  - a paged entry table (index -> pointer/length). Pages are allocated once and
+//    never move, so readers can look IDs up without locking.
+// Index 0 is unused in every shard, which keeps ID 0 free for "".
+
+static const uint32_t shardBits = 4;
+static const uint32_t shardCount = 1u << shardBits;
+static const size_t blockBytes = 64 * 1024;
+static const size_t entriesPerPage = 64 * 1024;
+static const size_t maxPages = 4096; // 2^28 strings per shard
+
+struct PoolEntry {
+    const char* data;
+    uint32_t length;
+};
+
+struct PoolShard {
+    mutex lock;
+    unordered_map<string_view, uint32_t> ids;
+    vector<char*> blocks;
+    size_t blockUsed = blockBytes; // forces a block allocation on first use
+    size_t bytes = 0;
+    uint32_t nextIndex = 1;
+    atomic<PoolEntry*> pages[maxPages] = {};
+};
+
+static PoolShard shards[shardCount];
+
+// Copies the characters into the shard's arena and returns the stored copy.
+// Strings longer than a block get a block of their own.
+static const char* copyToArena(PoolShard& shard, string_view s) {
+    if (s.size() > blockBytes) {
+        char* big = new char[s.size()];
+        memcpy(big, s.data(), s.size());
+        shard.blocks.push_back(big);
+        return big;
+    }
+    if (shard.blockUsed + s.size() > blockBytes) {
+        shard.blocks.push_back(new char[blockBytes]);
+        shard.blockUsed = 0;
+    }
+    char* dst = shard.blocks.back() + shard.blockUsed;
+    memcpy(dst, s.data(), s.size());
+    shard.blockUsed += s.size();
+    return dst;
+}
+
+uint32_t internString(string_view s) {
+    if (s.empty()) return 0;
+
+    uint32_t shardNo = (uint32_t)(hash<string_view>()(s) & (shardCount - 1));
+    PoolShard& shard = shards[shardNo];
+    lock_guard<mutex> guard(shard.lock);
+
+    auto it = shard.ids.find(s);
+    if (it != shard.ids.end()) return it->second;
+
+    uint32_t index = shard.nextIndex++;
+    size_t pageNo = index / entriesPerPage;
+    PoolEntry* page = shard.pages[pageNo].load(memory_order_relaxed);
+    if (!page) {
+        page = new PoolEntry[entriesPerPage];
+        shard.pages[pageNo].store(page, memory_order_release);
+    }
+
+    const char* stored = copyToArena(shard, s);
+    page[index % entriesPerPage] = PoolEntry{ stored, (uint32_t)s.size() };
+    shard.bytes += s.size();
+
+    uint32_t id = (index << shardBits) | shardNo;
+    shard.ids.emplace(string_view(stored, s.size()), id);
+    return id;
+}
+
+string_view pooledString(uint32_t id) {
+    if (id == 0) return string_view();
+    const PoolShard& shard = shards[id & (shardCount - 1)];
+    uint32_t index = id >> shardBits;
+    const PoolEntry* page = shard.pages[index / entriesPerPage].load(memory_order_acquire);
+    const PoolEntry& e = page[index % entriesPerPage];
+    return string_view(e.data, e.length);
+}
+
+size_t stringPoolBytes() {
+    size_t total = 0;
+    for (PoolShard& shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        total += shard.bytes;
+    }
+    return total;
+}
@@ -0,0 +1,23 @@
+#ifndef STRPOOL_H
+#define STRPOOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+// Process-wide string pool for food names and serving units.
+// Strings are copied once into arena blocks that are never moved or freed, so
+// every equal string shares one 32-bit ID and views stay valid for the whole run.
+// Interning is thread-safe (the pool is split into independently locked shards);
+// looking an ID up never takes a lock.
+
+// Returns the ID for a string, adding it to the pool on first use. "" is always 0.
+uint32_t internString(std::string_view s);
+
+// Returns the string for an ID from internString.
+std::string_view pooledString(uint32_t id);
+
+// Total bytes of string data held by the pool (for diagnostics).
+size_t stringPoolBytes();
+
+#endif
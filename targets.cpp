@@ -0,0 +1,188 @@
+#include "targets.h"
+#include "profilestore.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <numeric>
+#include <utility>
+
+using namespace std;
+
+ActivityLevel parseActivityLevel(const string& level) {
+    if (level.find("Lightly") != string::npos) return ACTIVITY_LIGHT;
+    if (level.find("Moderately") != string::npos) return ACTIVITY_MODERATE;
+    if (level.find("Very") != string::npos) return ACTIVITY_VERY;
+    return ACTIVITY_SEDENTARY;
+}
+
+BmrFormula parseBmrFormula(const string& name) {
+    for (uint8_t f = 0; f < BMR_FORMULAS; ++f) {
+        if (name == BMR_FORMULA_NAMES[f]) return (BmrFormula)f;
+    }
+    return BMR_MIFFLIN_ST_JEOR;
+}
+
+MacroStrategy parseMacroStrategy(const string& name) {
+    for (uint8_t s = 0; s < MACRO_STRATEGIES; ++s) {
+        if (name == MACRO_SPLITS[s].name) return (MacroStrategy)s;
+    }
+    return MACRO_BALANCED;
+}
+
+// --- Policy tables ---
+// Entry f * MACRO_STRATEGIES + s is the instantiation for formula f and split s.
+
+template <size_t... I>
+static constexpr array<TargetRowFunction, sizeof...(I)> makeRowTable(index_sequence<I...>) {
+    return {{ &macroTargetsFor<(BmrFormula)(I / MACRO_STRATEGIES), (MacroStrategy)(I % MACRO_STRATEGIES)>... }};
+}
+
+static constexpr auto rowFunctions = makeRowTable(make_index_sequence<BMR_FORMULAS * MACRO_STRATEGIES>());
+
+TargetRowFunction targetRowFunction(BmrFormula formula, MacroStrategy strategy) {
+    return rowFunctions[(formula % BMR_FORMULAS) * MACRO_STRATEGIES + (strategy % MACRO_STRATEGIES)];
+}
+
+// One policy's loop over n rows: plain pointers over contiguous arrays, no
+// branches, the row formula inlined. The arrays are __restrict parameters
+// (GCC ignores it on local variables); without it the compiler has to assume
+// the outputs overlap the inputs and gives up on vectorizing.
+template <BmrFormula F, MacroStrategy S>
+static void targetLoop(size_t n, const double* __restrict w, const double* __restrict h,
+                       const double* __restrict a, const double* __restrict male, const double* __restrict bf,
+                       const double* __restrict mult, double* __restrict cal, double* __restrict prot,
+                       double* __restrict carb, double* __restrict fat) {
+    for (size_t i = 0; i < n; ++i) {
+        TargetInputs in;
+        in.weightKg = w[i];
+        in.heightCm = h[i];
+        in.age = a[i];
+        in.male = male[i];
+        in.bodyFatPercent = bf[i];
+        in.multiplier = mult[i];
+        MacroTargets t = macroTargetsFor<F, S>(in);
+        cal[i] = t.calories;
+        prot[i] = t.protein;
+        carb[i] = t.carbs;
+        fat[i] = t.fat;
+    }
+}
+
+// Rows [begin, end) of the batch.
+template <BmrFormula F, MacroStrategy S>
+static void targetKernel(ProfileBatch& batch, size_t begin, size_t end) {
+    targetLoop<F, S>(end - begin, batch.weightKg.data() + begin, batch.heightCm.data() + begin,
+                     batch.age.data() + begin, batch.male.data() + begin, batch.bodyFatPercent.data() + begin,
+                     batch.multiplier.data() + begin, batch.calories.data() + begin, batch.protein.data() + begin,
+                     batch.carbs.data() + begin, batch.fat.data() + begin);
+}
+
+using TargetKernel = void (*)(ProfileBatch&, size_t, size_t);
+
+template <size_t... I>
+static constexpr array<TargetKernel, sizeof...(I)> makeKernelTable(index_sequence<I...>) {
+    return {{ &targetKernel<(BmrFormula)(I / MACRO_STRATEGIES), (MacroStrategy)(I % MACRO_STRATEGIES)>... }};
+}
+
+static constexpr auto kernels = makeKernelTable(make_index_sequence<BMR_FORMULAS * MACRO_STRATEGIES>());
+
+// --- Batch ---
+
+void addToBatch(ProfileBatch& batch, const UserProfile& p) {
+    batch.userIds.push_back(p.userId);
+    batch.usernames.push_back(p.username);
+    batch.weightKg.push_back(p.weight_kg);
+    batch.heightCm.push_back(p.height_cm);
+    batch.age.push_back(p.age);
+    batch.male.push_back(maleFactor(p.gender));
+    batch.bodyFatPercent.push_back(p.bodyFatPercent);
+    batch.multiplier.push_back(ACTIVITY_MULTIPLIERS[p.activityLevel % ACTIVITY_LEVELS]);
+    batch.policy.push_back((uint8_t)((p.bmrFormula % BMR_FORMULAS) * MACRO_STRATEGIES + (p.macroStrategy % MACRO_STRATEGIES)));
+    batch.storedCalories.push_back((int)p.dailyCaloriesTarget);
+}
+
+template <class T>
+static void applyOrder(vector<T>& column, const vector<size_t>& order) {
+    vector<T> sorted;
+    sorted.reserve(column.size());
+    for (size_t i : order) sorted.push_back(move(column[i]));
+    column.swap(sorted);
+}
+
+// Groups the rows by policy (stable, so users keep their users.txt order within a group).
+static void groupByPolicy(ProfileBatch& batch) {
+    if (is_sorted(batch.policy.begin(), batch.policy.end())) return;
+    vector<size_t> order(batch.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&batch](size_t a, size_t b) { return batch.policy[a] < batch.policy[b]; });
+    applyOrder(batch.userIds, order);
+    applyOrder(batch.usernames, order);
+    applyOrder(batch.weightKg, order);
+    applyOrder(batch.heightCm, order);
+    applyOrder(batch.age, order);
+    applyOrder(batch.male, order);
+    applyOrder(batch.bodyFatPercent, order);
+    applyOrder(batch.multiplier, order);
+    applyOrder(batch.policy, order);
+    applyOrder(batch.storedCalories, order);
+    applyOrder(batch.storedChecksums, order);
+}
+
+size_t loadProfileBatch(ProfileBatch& batch) {
+    importMissingProfiles();
+    vector<ProfileRecord> records;
+    readProfileRecords(records);
+    for (uint32_t id = 0; id < records.size(); ++id) {
+        if (records[id].username[0] == '\0') continue;   // damaged
+        UserProfile p;
+        unpackProfile(records[id], id, p, false);
+        addToBatch(batch, p);
+        batch.storedChecksums.push_back(records[id].checksum);
+    }
+    groupByPolicy(batch);
+    return records.size();
+}
+
+void computeTargets(ProfileBatch& batch) {
+    size_t n = batch.size();
+    batch.calories.resize(n);
+    batch.protein.resize(n);
+    batch.carbs.resize(n);
+    batch.fat.resize(n);
+
+    for (size_t begin = 0; begin < n;) {
+        size_t end = begin + 1;
+        while (end < n && batch.policy[end] == batch.policy[begin]) ++end;
+        kernels[batch.policy[begin]](batch, begin, end);
+        begin = end;
+    }
+}
+
+size_t writeBackTargets(const ProfileBatch& batch) {
+    vector<uint32_t> ids;
+    vector<int> calories;
+    vector<uint32_t> checksums;
+    for (size_t i = 0; i < batch.size() && i < batch.storedChecksums.size(); ++i) {
+        int kcal = (int)batch.calories[i];
+        if (kcal == batch.storedCalories[i]) continue;
+        ids.push_back(batch.userIds[i]);
+        calories.push_back(kcal);
+        checksums.push_back(batch.storedChecksums[i]);
+    }
+    return writeCalorieTargets(ids, calories, checksums);
+}
+
+void recomputeAllTargets(ostream& out) {
+    ProfileBatch batch;
+    loadProfileBatch(batch);
+
+    auto start = chrono::steady_clock::now();
+    computeTargets(batch);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t updated = writeBackTargets(batch);
+    out << "Recomputed targets for " << batch.size() << " profile(s) in " << fixed << setprecision(3)
+        << seconds * 1000.0 << " ms; " << updated << " profile(s) updated.\n";
+    out.unsetf(ios::fixed);
+}
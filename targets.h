@@ -0,0 +1,160 @@
+#ifndef TARGETS_H
+#define TARGETS_H
+
+#include "models.h"
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Batch target engine: recomputes the calorie and macro targets of every
+// registered user at once (e.g. after changing the activity multipliers or
+// the macro split).
+//
+// Profiles are read from the profile store (profilestore.h) in one pass into
+// structure-of-arrays form. Gender and activity level become table values
+// while loading, and rows are grouped by their
+// formula and macro split, so each group is one branch-free loop over
+// contiguous arrays that the compiler specializes and vectorizes (at -O3, see
+// the build command in README; confirm with -fopt-info-vec).
+// calcMacroTargets (profile.h) uses the same row formulas, so the per-login
+// and batch paths always agree.
+
+// Indexed by ActivityLevel (models.h).
+const double ACTIVITY_MULTIPLIERS[ACTIVITY_LEVELS] = { 1.2, 1.375, 1.55, 1.725 };
+
+// Parses an activity level as written in text files ("Lightly Active", ...).
+// Unknown text counts as sedentary.
+ActivityLevel parseActivityLevel(const std::string& level);
+
+// 1.0 for male, else 0.0. Formulas blend their female and male terms with
+// it instead of branching.
+inline double maleFactor(Gender gender) {
+    return gender == GENDER_MALE ? 1.0 : 0.0;
+}
+
+// --- Policies ---
+// Formulas and macro splits are selected per user (UserProfile::bmrFormula and
+// ::macroStrategy). Each combination is its own template instantiation, so no
+// row pays for a virtual call or a comparison to pick its policy.
+
+const char* const BMR_FORMULA_NAMES[BMR_FORMULAS] = { "Mifflin-St Jeor", "Harris-Benedict", "Katch-McArdle" };
+
+// Macro split: protein per kg of body weight, and carbs and fat as shares of
+// the calorie target.
+struct MacroSplit {
+    const char* name;
+    double proteinPerKg;
+    double carbShare;
+    double fatShare;
+};
+
+constexpr MacroSplit MACRO_SPLITS[MACRO_STRATEGIES] = {
+    { "Balanced", 2.0, 0.55, 0.25 },
+    { "High protein", 2.4, 0.40, 0.30 },
+    { "Low fat", 1.8, 0.60, 0.20 },
+    { "Keto", 1.6, 0.05, 0.70 },
+};
+
+// Names as stored in the profile; unknown names give the defaults.
+BmrFormula parseBmrFormula(const std::string& name);
+MacroStrategy parseMacroStrategy(const std::string& name);
+
+// Targets of one profile.
+struct MacroTargets {
+    double calories = 0.0;
+    double protein = 0.0;
+    double carbs = 0.0;
+    double fat = 0.0;
+};
+
+// Inputs of one row.
+struct TargetInputs {
+    double weightKg = 0.0;
+    double heightCm = 0.0;
+    double age = 0.0;
+    double male = 0.0;            // maleFactor
+    double bodyFatPercent = 0.0;  // Katch-McArdle only
+    double multiplier = 1.2;      // ACTIVITY_MULTIPLIERS[activity]
+};
+
+template <BmrFormula F>
+inline double bmrFor(const TargetInputs& in) {
+    if constexpr (F == BMR_HARRIS_BENEDICT) {
+        // Roza-Shizgal revision: female terms plus male * (male - female)
+        double female = 447.593 + 9.247 * in.weightKg + 3.098 * in.heightCm - 4.330 * in.age;
+        double maleDelta = -359.231 + 4.150 * in.weightKg + 1.701 * in.heightCm - 1.347 * in.age;
+        return female + in.male * maleDelta;
+    } else if constexpr (F == BMR_KATCH_MCARDLE) {
+        return 370.0 + 21.6 * in.weightKg * (1.0 - in.bodyFatPercent / 100.0);
+    } else {
+        return 10.0 * in.weightKg + 6.25 * in.heightCm - 5.0 * in.age + (-161.0 + 166.0 * in.male);
+    }
+}
+
+// Rounds a target to whole units, like std::round for these positive values
+// (far inside int range). The conversion vectorizes with plain SSE2
+// (cvttpd2dq); std::floor does not without -fno-trapping-math.
+inline double roundTarget(double x) {
+    return (double)(int32_t)(x + 0.5);
+}
+
+// Targets of one row: BMR times the activity multiplier, then the macro split.
+template <BmrFormula F, MacroStrategy S>
+inline MacroTargets macroTargetsFor(const TargetInputs& in) {
+    constexpr MacroSplit split = MACRO_SPLITS[S];
+    MacroTargets t;
+    t.calories = roundTarget(bmrFor<F>(in) * in.multiplier);
+    t.protein = roundTarget(in.weightKg * split.proteinPerKg);
+    t.carbs = roundTarget(t.calories * split.carbShare / 4.0);
+    t.fat = roundTarget(t.calories * split.fatShare / 9.0);
+    return t;
+}
+
+// The instantiation for a user's policies (used by calcMacroTargets).
+using TargetRowFunction = MacroTargets (*)(const TargetInputs&);
+TargetRowFunction targetRowFunction(BmrFormula formula, MacroStrategy strategy);
+
+// All users' inputs and results, one array per field.
+struct ProfileBatch {
+    std::vector<uint32_t> userIds;         // profile store IDs (profilestore.h)
+    std::vector<std::string> usernames;
+    std::vector<double> weightKg;
+    std::vector<double> heightCm;
+    std::vector<double> age;
+    std::vector<double> male;             // maleFactor(gender)
+    std::vector<double> bodyFatPercent;
+    std::vector<double> multiplier;       // ACTIVITY_MULTIPLIERS[activity]
+    std::vector<uint8_t> policy;          // bmrFormula * MACRO_STRATEGIES + macroStrategy
+    std::vector<int> storedCalories;      // calorie target in the stored profile
+    std::vector<uint32_t> storedChecksums; // record checksum when loaded (writeBackTargets)
+
+    std::vector<double> calories;         // results (computeTargets)
+    std::vector<double> protein;
+    std::vector<double> carbs;
+    std::vector<double> fat;
+
+    size_t size() const { return usernames.size(); }
+};
+
+// Appends one profile (table lookups happen here, not in the kernel).
+void addToBatch(ProfileBatch& batch, const UserProfile& p);
+
+// Loads every stored profile, grouped by policy. Users in users.txt that are
+// not in the store yet are imported first. Returns the number of profiles loaded.
+size_t loadProfileBatch(ProfileBatch& batch);
+
+// Computes the targets of every profile in the batch: one specialized loop
+// per run of rows with the same policy.
+void computeTargets(ProfileBatch& batch);
+
+// Writes each changed calorie target back to the profile store in one pass,
+// skipping profiles another session has updated since they were loaded.
+// Returns the number of profiles updated.
+size_t writeBackTargets(const ProfileBatch& batch);
+
+// "--recompute-targets": load, compute and write back; prints a summary.
+void recomputeAllTargets(std::ostream& out);
+
+#endif
@@ -0,0 +1,300 @@
+#include "trends.h"
+#include "filelock.h"
+#include "logstore.h"
+#include "targets.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+static const int trendHistoryDays = 90;   // longest window
+
+// Ring of the last trendHistoryDays daily totals ending at endDay.
+struct TrendState {
+    int endDay = NO_DAY;
+    DayTotals ring[trendHistoryDays];
+    TrendWindow windows[TREND_WINDOW_COUNT];
+};
+
+// States are cached per user with the file's stamp (filelock.h), so a state
+// another session has saved or appended to since is loaded again.
+static map<string, TrendState> trendStates;
+static map<string, FileStamp> trendTimes;
+
+static string trendFileName(const string& username) {
+    return userFilePath(username, "trends.txt");
+}
+
+static int ringSlot(int day) {
+    return ((day % trendHistoryDays) + trendHistoryDays) % trendHistoryDays;
+}
+
+static void addTotals(DayTotals& into, const DayTotals& t, int sign) {
+    into.calories += sign * t.calories;
+    into.protein += sign * t.protein;
+    into.carbs += sign * t.carbs;
+    into.fat += sign * t.fat;
+    into.entries += sign * t.entries;
+}
+
+static void resetState(TrendState& state, int endDay) {
+    state.endDay = endDay;
+    for (DayTotals& d : state.ring) d = DayTotals();
+    for (int w = 0; w < TREND_WINDOW_COUNT; ++w) {
+        state.windows[w] = TrendWindow();
+        state.windows[w].days = TREND_WINDOWS[w];
+    }
+}
+
+// Slides every window forward to end at day, dropping the days that leave it.
+static void rollTo(TrendState& state, int day) {
+    if (day <= state.endDay) return;
+    if (state.endDay == NO_DAY || day - state.endDay >= trendHistoryDays) {
+        resetState(state, day);
+        return;
+    }
+    for (int d = state.endDay + 1; d <= day; ++d) {
+        for (TrendWindow& w : state.windows) {
+            const DayTotals& leaving = state.ring[ringSlot(d - w.days)];
+            addTotals(w.sums, leaving, -1);
+            if (leaving.entries > 0) w.loggedDays--;
+        }
+        state.ring[ringSlot(d)] = DayTotals();
+    }
+    state.endDay = day;
+}
+
+// Adds a day's amounts (one record or a saved day) to the ring and windows.
+// A tombstone adds negative amounts and removes one entry.
+static void addDay(TrendState& state, int day, const DayTotals& t) {
+    rollTo(state, day);
+    if (day <= state.endDay - trendHistoryDays) return;   // older than any window
+
+    DayTotals& slot = state.ring[ringSlot(day)];
+    bool wasEmpty = (slot.entries == 0);
+    addTotals(slot, t, 1);
+    for (TrendWindow& w : state.windows) {
+        if (day <= state.endDay - w.days) continue;
+        addTotals(w.sums, t, 1);
+        if (wasEmpty && slot.entries > 0) w.loggedDays++;
+        else if (!wasEmpty && slot.entries == 0) w.loggedDays--;   // last entry deleted
+    }
+}
+
+// --- Persistence ---
+// Format: "END|YYYY-MM-DD", then one line per day with entries:
+// YYYY-MM-DD|calories|protein|carbs|fat|entries (fixed-point tenths),
+// followed by the lines log writes have appended since, in the same form.
+
+static FileStamp trendTime(const string& username) {
+    return fileStamp(trendFileName(username));
+}
+
+// Written through a temporary file, so a session reading or appending never
+// sees it half written.
+static void saveState(const string& username, const TrendState& state) {
+    string filename = trendFileName(username);
+    string tmp = filename + ".tmp";
+    {
+        ofstream out(tmp, ios::trunc);
+        out << "END|" << dayNumberToDate(state.endDay) << "\n";
+        for (int d = state.endDay - trendHistoryDays + 1; d <= state.endDay; ++d) {
+            const DayTotals& t = state.ring[ringSlot(d)];
+            if (t.entries == 0) continue;
+            out << dayNumberToDate(d) << "|" << t.calories << "|" << t.protein << "|"
+                << t.carbs << "|" << t.fat << "|" << t.entries << "\n";
+        }
+        if (!out) return;
+    }
+    replaceFile(tmp, filename);
+    trendTimes[username] = trendTime(username);
+}
+
+static bool loadState(const string& username, TrendState& state) {
+    ifstream file(trendFileName(username));
+    string line;
+    if (!file || !getline(file, line) || line.rfind("END|", 0) != 0) return false;
+    int endDay = dateToDayNumber(trim(line.substr(4)));
+    if (endDay == NO_DAY) return false;
+    resetState(state, endDay);
+
+    // Day lines add up, so the lines appended since the last save are simply
+    // read on; a last line without its newline is still being appended
+    while (getline(file, line) && !file.eof()) {
+        vector<string> parts;
+        stringstream ss(line);
+        string part;
+        while (getline(ss, part, '|')) parts.push_back(trim(part));
+        if (parts.size() < 6) continue;
+        int day = dateToDayNumber(parts[0]);
+        if (day == NO_DAY) continue;
+        try {
+            DayTotals t;
+            t.calories = stoll(parts[1]);
+            t.protein = stoll(parts[2]);
+            t.carbs = stoll(parts[3]);
+            t.fat = stoll(parts[4]);
+            t.entries = stoi(parts[5]);
+            addDay(state, day, t);
+        } catch (...) {
+            continue;
+        }
+    }
+    return true;
+}
+
+// Returns the cached state, loading it again if the file changed since, or
+// (first time only) seeding it from the last 90 days of the log under the
+// user's exclusive lock. seeded is set when the log was read. Not called under
+// the shared lock: taking the exclusive one would let other sessions in.
+static TrendState& trendStateFor(const string& username, bool* seeded = nullptr) {
+    if (seeded) *seeded = false;
+    auto it = trendStates.find(username);
+    if (it != trendStates.end() && trendTimes[username] == trendTime(username)) return it->second;
+
+    TrendState& state = trendStates[username];
+    trendTimes[username] = trendTime(username);
+    if (loadState(username, state)) return state;
+
+    // Another session may be seeding: wait for it, then look again
+    FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    trendTimes[username] = trendTime(username);
+    if (loadState(username, state)) return state;
+
+    if (seeded) *seeded = true;
+    int today = dateToDayNumber(getTodayDate());
+    resetState(state, today);
+    scanLog(username, today - trendHistoryDays + 1, today, [&state](const LogRecord& r) {
+        DayTotals t;
+        sumLogRecords(&r, 1, t);
+        addDay(state, r.day, t);
+    });
+    saveState(username, state);
+    return state;
+}
+
+// --- Public API ---
+
+bool hasTrendState(const string& username) {
+    error_code ec;
+    return filesystem::exists(trendFileName(username), ec);
+}
+
+void recordTrendDays(const string& username, const vector<LogRecord>& records, bool hadState) {
+    // Without a file the seed reads the records from the log; one cannot have
+    // been written since hadState was taken, as that needs the exclusive lock
+    if (!hadState) return;
+    FileLock lock(userLockFile(username), LOCK_MODE_SHARED);
+
+    // One line per day touched, in a single write
+    map<int, DayTotals> days;
+    for (const LogRecord& r : records) sumLogRecords(&r, 1, days[r.day]);
+    stringstream lines;
+    for (const auto& day : days) {
+        const DayTotals& t = day.second;
+        lines << dayNumberToDate(day.first) << "|" << t.calories << "|" << t.protein << "|"
+              << t.carbs << "|" << t.fat << "|" << t.entries << "\n";
+    }
+    string buffer = lines.str();
+    appendToFile(trendFileName(username), buffer);
+    trendStates.erase(username);
+}
+
+void compactTrendDays(const string& username) {
+    FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    trendStates.erase(username);
+    trendTimes.erase(username);
+    bool seeded;
+    TrendState& state = trendStateFor(username, &seeded);
+    if (seeded) return;
+    rollTo(state, dateToDayNumber(getTodayDate()));
+    saveState(username, state);
+}
+
+void getTrends(const string& username, TrendWindow windows[TREND_WINDOW_COUNT]) {
+    TrendState& state = trendStateFor(username);
+    rollTo(state, dateToDayNumber(getTodayDate()));
+    for (int w = 0; w < TREND_WINDOW_COUNT; ++w) windows[w] = state.windows[w];
+}
+
+// --- Display and export ---
+
+static double windowAverage(const TrendWindow& w, int64_t sum) {
+    return w.loggedDays > 0 ? fromFixed(sum) / w.loggedDays : 0.0;
+}
+
+static double deviationPercent(double average, double target) {
+    return target > 0 ? (average - target) / target * 100.0 : 0.0;
+}
+
+static string signedPercent(double pct) {
+    stringstream ss;
+    ss << (pct >= 0 ? "+" : "") << fixed << setprecision(0) << pct << "%";
+    return ss.str();
+}
+
+void runTrendView(const UserProfile& p) {
+    printHeader("TRENDS", "rolling averages per day with entries");
+    TrendWindow windows[TREND_WINDOW_COUNT];
+    getTrends(p.username, windows);
+
+    const double targets[4] = { p.dailyCaloriesTarget, p.targetProtein_g, p.targetCarbs_g, p.targetFat_g };
+    cout << left << setw(10) << "Window" << setw(8) << "Days"
+         << setw(16) << "Calories" << setw(14) << "Protein"
+         << setw(14) << "Carbs" << "Fat" << "\n";
+    cout << "-------------------------------------------------------------------------\n";
+    for (const TrendWindow& w : windows) {
+        const int64_t sums[4] = { w.sums.calories, w.sums.protein, w.sums.carbs, w.sums.fat };
+        cout << left << setw(10) << (to_string(w.days) + "-day")
+             << setw(8) << (to_string(w.loggedDays) + "/" + to_string(w.days));
+        for (int n = 0; n < 4; ++n) {
+            double avg = windowAverage(w, sums[n]);
+            string cell = to_string((int)llround(avg)) + (n == 0 ? "" : "g") + " (" +
+                          signedPercent(deviationPercent(avg, targets[n])) + ")";
+            if (n < 3) cout << setw(n == 0 ? 16 : 14) << cell;
+            else cout << cell;
+        }
+        cout << "\n";
+    }
+    cout << "\nTargets: " << (int)targets[0] << " kcal, " << (int)targets[1] << "g protein, "
+         << (int)targets[2] << "g carbs, " << (int)targets[3] << "g fat.\n"
+         << "Percentages are the deviation of the average from the target.\n";
+    pauseConsole();
+}
+
+void exportCoachingTrends(ostream& out) {
+    out << "username,window,loggedDays,calories,protein,carbs,fat,"
+           "calories%,protein%,carbs%,fat%\n";
+    out << fixed << setprecision(1);
+
+    // Only the users' trends files are read: a user without one (never logged
+    // since trends were added) is left out rather than seeded from the log.
+    // Targets of all users come from one batch computation (targets.h)
+    int today = dateToDayNumber(getTodayDate());
+    ProfileBatch batch;
+    loadProfileBatch(batch);
+    computeTargets(batch);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const string& username = batch.usernames[i];
+        const double targets[4] = { batch.calories[i], batch.protein[i], batch.carbs[i], batch.fat[i] };
+
+        TrendState state;
+        if (!loadState(username, state)) continue;
+        rollTo(state, today);
+        for (const TrendWindow& w : state.windows) {
+            const int64_t sums[4] = { w.sums.calories, w.sums.protein, w.sums.carbs, w.sums.fat };
+            out << username << "," << w.days << "," << w.loggedDays;
+            for (int n = 0; n < 4; ++n) out << "," << windowAverage(w, sums[n]);
+            for (int n = 0; n < 4; ++n) out << "," << deviationPercent(windowAverage(w, sums[n]), targets[n]);
+            out << "\n";
+        }
+    }
+    out.unsetf(ios::fixed);
+}
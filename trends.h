@@ -0,0 +1,54 @@
+#ifndef TRENDS_H
+#define TRENDS_H
+
+#include "models.h"
+#include <string>
+#include <iostream>
+#include <vector>
+
+// Rolling 7/30/90-day averages per user.
+//
+// Each user has a small state file (trends.txt) holding the daily
+// totals of the last 90 days. The three window sums are sliding accumulators:
+// a log write adds the record to every window covering its day, and moving to
+// a new day subtracts the days that fall out. Neither step reads the log, so
+// trends for all users cost one small file read each. Log writes append their
+// days to the file under the user's shared lock; compaction folds them in.
+
+const int TREND_WINDOW_COUNT = 3;
+const int TREND_WINDOWS[TREND_WINDOW_COUNT] = { 7, 30, 90 };
+
+struct TrendWindow {
+    int days = 0;            // window length
+    DayTotals sums;          // fixed-point sums over the window
+    int loggedDays = 0;      // days in the window with at least one entry
+};
+
+// True if the user's trends file exists.
+bool hasTrendState(const std::string& username);
+
+// Appends written records to the user's trends file, one line per day.
+// Called by the log writer (logRecords in logstore.h) under the user's shared
+// lock; hadState is hasTrendState from before the records were written,
+// under the same lock. A user without a trends file is left to be seeded from
+// the log.
+void recordTrendDays(const std::string& username, const std::vector<LogRecord>& records, bool hadState);
+
+// Folds the appended lines into the state and rolls it to today. Takes the
+// user's exclusive lock; called by compactLog (logstore.h).
+void compactTrendDays(const std::string& username);
+
+// The user's windows ending today (rolled forward if days have passed). The
+// cached state is reloaded when another session has saved the file since.
+void getTrends(const std::string& username, TrendWindow windows[TREND_WINDOW_COUNT]);
+
+// Reports menu: averages and deviation from target for each window.
+void runTrendView(const UserProfile& p);
+
+// Writes one CSV line per user and window (registered users from users.txt):
+// username,window,loggedDays,calories,protein,carbs,fat,calories%,protein%,carbs%,fat%
+// Averages are per day with entries; % columns are deviation from target.
+// Reads only the trends files: users without one are left out.
+void exportCoachingTrends(std::ostream& out);
+
+#endif
@@ -0,0 +1,159 @@
+#include "usage.h"
+#include "filelock.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+// In-memory usage tables, keyed by username and then by lower-cased food name.
+// A table is cached with the file's stamp (filelock.h) and loaded again when
+// the file has changed, e.g. after another session appended to it.
+static map<string, map<string, FoodUsage>> usageCache;
+static map<string, FileStamp> usageTimes;
+
+// Name of the per-user usage file.
+static string usageFileName(const string& username) {
+    return userFilePath(username, "usage.txt");
+}
+
+static FileStamp usageTime(const string& username) {
+    return fileStamp(usageFileName(username));
+}
+
+// Updates count, last-used date and typical amount for one logged food.
+// The typical amount is an exponential moving average so that it follows
+// changes in the user's portions without storing every past amount.
+static void updateUsage(map<string, FoodUsage>& table, const string& foodName, double grams, const string& date) {
+    FoodUsage& u = table[toLower(trim(foodName))];
+
+    if (u.count == 0 || u.typicalGrams <= 0.0) u.typicalGrams = grams;
+    else if (grams > 0.0) u.typicalGrams = 0.7 * u.typicalGrams + 0.3 * grams;
+
+    u.count++;
+    if (u.lastUsed.empty() || date > u.lastUsed) u.lastUsed = date;
+}
+
+// Format: one row per distinct food, name|count|lastUsed|typicalGrams, as
+// the last compaction left them, followed by one line per food logged since:
+// +|date|grams|name. Those are replayed in order on load. A last line without
+// its newline (an append still in progress) is left out.
+static void loadUsageTable(const string& username, map<string, FoodUsage>& table) {
+    table.clear();
+    ifstream file(usageFileName(username));
+    string line;
+    while (getline(file, line) && !file.eof()) {
+        vector<string> parts;
+        stringstream ss(line);
+        string segment;
+        while (parts.size() < 3 && getline(ss, segment, '|')) parts.push_back(trim(segment));
+        if (parts.size() == 3 && parts[0] == "+") {
+            string name;
+            getline(ss, name);
+            try {
+                if (!trim(name).empty()) updateUsage(table, name, stod(parts[2]), parts[1]);
+            } catch (...) {
+            }
+            continue;
+        }
+        while (getline(ss, segment, '|')) parts.push_back(trim(segment));
+        if (parts.size() < 4 || parts[0].empty()) continue;
+
+        FoodUsage u;
+        try {
+            u.count = stoi(parts[1]);
+            u.lastUsed = parts[2];
+            u.typicalGrams = stod(parts[3]);
+        } catch (...) {
+            continue;
+        }
+        table[toLower(parts[0])] = u;
+    }
+}
+
+// Returns the user's usage table, loading it again if the file has changed.
+static map<string, FoodUsage>& getUsageTable(const string& username) {
+    FileStamp stamp = usageTime(username);
+    auto it = usageCache.find(username);
+    if (it != usageCache.end() && usageTimes[username] == stamp) return it->second;
+
+    map<string, FoodUsage>& table = usageCache[username];
+    usageTimes[username] = stamp;
+    loadUsageTable(username, table);
+    return table;
+}
+
+void recordFoodUsage(const string& username, const string& foodName, double grams, const string& date) {
+    recordFoodUsage(username, vector<pair<string, double>>(1, make_pair(foodName, grams)), date);
+}
+
+// One appended line per food, in a single write under the user's shared lock,
+// so sessions of the same user log side by side.
+void recordFoodUsage(const string& username, const vector<pair<string, double>>& foods, const string& date) {
+    if (username.empty() || foods.empty()) return;
+    stringstream lines;
+    lines << fixed << setprecision(1);
+    for (const auto& food : foods) {
+        if (!trim(food.first).empty()) lines << "+|" << date << "|" << food.second << "|" << trim(food.first) << "\n";
+    }
+    string buffer = lines.str();
+    if (buffer.empty()) return;
+
+    FileLock lock(userLockFile(username), LOCK_MODE_SHARED);
+    appendToFile(usageFileName(username), buffer);
+    usageCache.erase(username);
+}
+
+// Rewrites the file as one row per food, through a temporary file so readers
+// never see it half written. The file stays small no matter how long the
+// user's history grows.
+void compactFoodUsage(const string& username) {
+    FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    string filename = usageFileName(username);
+    error_code ec;
+    if (!filesystem::exists(filename, ec)) return;
+
+    map<string, FoodUsage> table;
+    loadUsageTable(username, table);
+    string tmp = filename + ".tmp";
+    {
+        ofstream out(tmp, ios::trunc);
+        if (!out) return;
+        out << fixed << setprecision(1);
+        for (const auto& row : table) {
+            out << row.first << "|" << row.second.count << "|"
+                << row.second.lastUsed << "|" << row.second.typicalGrams << "\n";
+        }
+        if (!out) return;
+    }
+    replaceFile(tmp, filename);
+}
+
+// Looks up the usage row for a single food.
+FoodUsage getFoodUsage(const string& username, const string& foodName) {
+    const map<string, FoodUsage>& table = getUsageTable(username);
+    auto it = table.find(toLower(trim(foodName)));
+    if (it == table.end()) return FoodUsage();
+    return it->second;
+}
+
+// Frequency is capped at 10 logs; recency falls off hyperbolically: half the
+// score after two weeks, a third after four.
+double usageScore(const string& username, const string& foodName) {
+    FoodUsage u = getFoodUsage(username, foodName);
+    if (u.count == 0) return 0.0;
+
+    double frequency = min(u.count, 10) / 10.0;
+
+    int last = dateToDayNumber(u.lastUsed);
+    int today = dateToDayNumber(getTodayDate());
+    double daysSince = (last == NO_DAY || today < last) ? 0.0 : (double)(today - last);
+    double recency = 1.0 / (1.0 + daysSince / 14.0);
+
+    return frequency * recency;
+}
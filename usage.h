@@ -0,0 +1,36 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// Per-food usage statistics for one user (one row of the user's usage.txt).
+struct FoodUsage {
+    int count = 0;              // how many times the food was logged
+    std::string lastUsed;       // "YYYY-MM-DD" of the most recent log
+    double typicalGrams = 0.0;  // smoothed amount the user usually logs
+};
+
+// Records one log write for the given food by appending a line to usage.txt
+// under the user's shared lock (filelock.h), so sessions are not held up by
+// each other. Called by the log writer (logRecords in logstore.h) so the
+// table never has to be rebuilt from the history.
+void recordFoodUsage(const std::string& username, const std::string& foodName, double grams, const std::string& date);
+
+// Same for several foods logged together (name, grams), in one write.
+void recordFoodUsage(const std::string& username, const std::vector<std::pair<std::string, double>>& foods,
+                     const std::string& date);
+
+// Folds the appended lines into one row per food. Takes the user's exclusive
+// lock; called by compactLog (logstore.h).
+void compactFoodUsage(const std::string& username);
+
+// Returns the usage row for a food (count == 0 if the user never logged it).
+FoodUsage getFoodUsage(const std::string& username, const std::string& foodName);
+
+// Ranking score in [0, 1] combining frequency and recency.
+// 0 means "never logged"; foods logged often and recently approach 1.
+double usageScore(const std::string& username, const std::string& foodName);
+
+#endif
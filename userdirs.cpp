@@ -0,0 +1,112 @@
+#include "userdirs.h"
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+
+using namespace std;
+
+static const char* const layoutMarkerName = "layout.txt";
+
+// "ab/cd" from the FNV-1a hash of the username.
+static string shardOf(const string& username) {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : username) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    char shard[8];
+    snprintf(shard, sizeof(shard), "%02x/%02x", (unsigned)(h & 0xff), (unsigned)((h >> 8) & 0xff));
+    return shard;
+}
+
+static string userDir(const string& username) {
+    return string(USER_DATA_ROOT) + "/" + shardOf(username) + "/" + username;
+}
+
+string userFilePath(const string& username, const string& name) {
+    return userDir(username) + "/" + name;
+}
+
+void ensureUserDir(const string& username) {
+    static mutex createdLock;
+    static set<string> created;   // absolute paths of directories known to exist
+    // Keyed by the absolute path, as the working directory may have changed
+    // since (the storage benchmark runs each engine in its own directory)
+    error_code ec;
+    string dir = filesystem::absolute(userDir(username), ec).string();
+    if (ec) dir = userDir(username);
+    lock_guard<mutex> guard(createdLock);
+    if (created.count(dir)) return;
+    // Concurrent creation by another session is not an error
+    filesystem::create_directories(dir, ec);
+    if (!ec) created.insert(dir);
+}
+
+// Splits "user_USERNAME_<name>" (usernames are letters and digits only).
+static bool parseFlatName(const string& file, string& username, string& name) {
+    if (file.rfind("user_", 0) != 0) return false;
+    size_t bar = file.find('_', 5);
+    if (bar == string::npos || bar == 5 || bar + 1 >= file.size()) return false;
+    username = file.substr(5, bar - 5);
+    name = file.substr(bar + 1);
+    for (char c : username) {
+        if (!isalnum((unsigned char)c)) return false;
+    }
+    // Half-written temporary files are left behind
+    return name.size() < 4 || name.compare(name.size() - 4, 4, ".tmp") != 0;
+}
+
+size_t migrateFlatLayout(ostream* log) {
+    size_t moved = 0, kept = 0;
+    // Files are moved while the directory is listed, so repeat until a pass
+    // finds nothing left to move; only one entry is held at a time. Files
+    // that stay are listed by every pass, so problems are reported by the first
+    bool firstPass = true;
+    for (size_t movedInPass = 1; movedInPass > 0; firstPass = false) {
+        movedInPass = 0;
+        kept = 0;
+        ostream* report = firstPass ? log : nullptr;
+        error_code ec;
+        for (filesystem::directory_iterator it(".", ec), end; !ec && it != end; it.increment(ec)) {
+            string username, name;
+            if (!it->is_regular_file(ec) || !parseFlatName(it->path().filename().string(), username, name)) continue;
+
+            ensureUserDir(username);
+            string target = userFilePath(username, name);
+            if (filesystem::exists(target, ec)) {
+                if (report) *report << "Not moved (target exists): " << it->path().filename().string() << "\n";
+                kept++;
+                continue;
+            }
+            error_code moveError;
+            filesystem::rename(it->path(), target, moveError);
+            if (moveError) {
+                if (report) *report << "Could not move " << it->path().filename().string() << ": " << moveError.message() << "\n";
+                kept++;
+                continue;
+            }
+            movedInPass++;
+        }
+        moved += movedInPass;
+    }
+    if (log) {
+        *log << "Moved " << moved << " user file(s) into " << USER_DATA_ROOT << "/";
+        if (kept > 0) *log << "; " << kept << " left in place";
+        *log << ".\n";
+    }
+    return moved;
+}
+
+void ensureDataLayout() {
+    string marker = string(USER_DATA_ROOT) + "/" + layoutMarkerName;
+    error_code ec;
+    if (filesystem::exists(marker, ec)) return;
+    filesystem::create_directories(USER_DATA_ROOT, ec);
+    size_t moved = migrateFlatLayout(nullptr);
+    if (moved > 0) cerr << "Moved " << moved << " user file(s) into " << USER_DATA_ROOT << "/.\n";
+    ofstream(marker) << "sharded 1\n";
+}
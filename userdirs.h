@@ -0,0 +1,43 @@
+#ifndef USERDIRS_H
+#define USERDIRS_H
+
+#include <iostream>
+#include <string>
+
+// Per-user file layout.
+//
+// Each user's files live in their own directory, data/ab/cd/USERNAME/, where
+// ab and cd are the first two bytes (hex) of a hash of the username. 65536
+// shard directories keep every directory small however many users there
+// are, and a user's files can be backed up or moved together. Shared files
+// (users.txt, foods.txt, food_ids.txt, profiles.dat) stay in the working
+// directory.
+//
+// The older flat layout kept every file in the working directory as
+// user_USERNAME_<name>; migrateFlatLayout moves those files to <name> in the
+// user's directory.
+
+const char* const USER_DATA_ROOT = "data";
+
+// Path of one of a user's files, e.g. userFilePath("bob", "weight.txt") ->
+// "data/3f/a2/bob/weight.txt". Only builds the path: nothing is created or
+// checked on disk, so read-only tools leave the data directory alone.
+std::string userFilePath(const std::string& username, const std::string& name);
+
+// Creates the user's directory if it does not exist yet. Called on
+// registration and by the writers of a user's own files (log, custom foods,
+// meals, recipes, weigh-ins, profile updates) before they create one; after
+// the first call per user it costs nothing. Safe to call from several threads.
+void ensureUserDir(const std::string& username);
+
+// Moves user_USERNAME_<name> files from the working directory into the
+// sharded layout. Files whose target already exists are left in place.
+// Writes a line per problem and a summary to log if given. Returns the
+// number of files moved.
+size_t migrateFlatLayout(std::ostream* log);
+
+// Runs migrateFlatLayout once per data directory (a marker file records that
+// it has run), so a start-up on the new layout costs one file check.
+void ensureDataLayout();
+
+#endif
@@ -1,5 +1,9 @@
 #include "utils.h"
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <ctime>
 #include <windows.h>
 
 using namespace std;
@@ -128,3 +132,55 @@ bool checkForBack(const string& input) {
     }
     return false;
 }
+
+// Returns the current system date formatted as a string "YYYY-MM-DD".
+// This is used to tag daily log entries.
+string getTodayDate() {
+    auto now = chrono::system_clock::now();
+    time_t now_time = chrono::system_clock::to_time_t(now);
+    tm* local_time = localtime(&now_time);
+    stringstream ss;
+    ss << (local_time->tm_year + 1900) << "-"
+       << setw(2) << setfill('0') << (local_time->tm_mon + 1) << "-"
+       << setw(2) << setfill('0') << local_time->tm_mday;
+    return ss.str();
+}
+
+// Converts a "YYYY-MM-DD" date into a day number (days since 1970-01-01).
+// Day numbers make date differences and ranges simple integer arithmetic.
+// Returns NO_DAY if the string is not a valid date (e.g. "2024-02-30").
+int dateToDayNumber(const string& date) {
+    int y = 0, m = 0, d = 0;
+    char dash1 = 0, dash2 = 0;
+    stringstream ss(trim(date));
+    if (!(ss >> y >> dash1 >> m >> dash2 >> d) || dash1 != '-' || dash2 != '-') return NO_DAY;
+    static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (m < 1 || m > 12 || d < 1 || d > monthDays[m - 1] + (m == 2 && leap)) return NO_DAY;
+
+    // Civil-from-days algorithm (proleptic Gregorian calendar)
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Converts a day number back into a "YYYY-MM-DD" string.
+string dayNumberToDate(int dayNumber) {
+    int z = dayNumber + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int y = yoe + era * 400;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int d = doy - (153 * mp + 2) / 5 + 1;
+    int m = mp + (mp < 10 ? 3 : -9);
+    if (m <= 2) y++;
+
+    stringstream ss;
+    ss << y << "-" << setw(2) << setfill('0') << m << "-" << setw(2) << setfill('0') << d;
+    return ss.str();
+}
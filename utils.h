@@ -16,6 +16,13 @@ bool isSimilar(std::string searchWord, std::string text);
 std::string trim(const std::string& str);
 bool checkForBack(const std::string& input);
 
+// Date helpers ("YYYY-MM-DD" strings and day numbers since 1970-01-01;
+// earlier dates are negative, so NO_DAY marks "no valid date")
+const int NO_DAY = std::numeric_limits<int>::min();
+std::string getTodayDate();
+int dateToDayNumber(const std::string& date);
+std::string dayNumberToDate(int dayNumber);
+
 // Input validation helpers
 void getValidInt(int& value, int min = -1, int max = -1);
 void getValidDouble(double& value, double min = -1.0, double max = -1.0);
@@ -0,0 +1,161 @@
+#include "weight.h"
+#include "filelock.h"
+#include "userdirs.h"
+#include "utils.h"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+// Running statistics. The regression sums use days relative to lastDay, so
+// they stay small however long the history is; they are shifted and faded
+// whenever a later day arrives.
+struct WeightStats {
+    WeightTrend trend;
+    double s0 = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+};
+
+static map<string, WeightStats> weightStats;
+
+static string weightFileName(const string& username) {
+    return userFilePath(username, "weight.txt");
+}
+
+static string weightStatsFileName(const string& username) {
+    return userFilePath(username, "weight_stats.txt");
+}
+
+// Least-squares slope of the faded points, in kg per week.
+static void updateSlope(WeightStats& s) {
+    WeightTrend& t = s.trend;
+    double det = s.s0 * s.sxx - s.sx * s.sx;
+    t.hasSlope = t.entries >= 3 && t.lastDay - t.firstDay >= 6 && det > 1e-9;
+    t.slopeKgPerWeek = t.hasSlope ? 7.0 * (s.s0 * s.sxy - s.sx * s.sy) / det : 0.0;
+}
+
+// Adds one weigh-in to the running statistics.
+static void addWeight(WeightStats& s, double kg, int day) {
+    WeightTrend& t = s.trend;
+    if (t.entries == 0) {
+        t.firstDay = day;
+        t.lastDay = day;
+        t.smoothedKg = kg;
+    }
+    int gap = max(day - t.lastDay, 0);   // a clock set back counts as the same day
+
+    if (gap > 0) {
+        // Move the origin to the new day, then fade the older points
+        double d = gap;
+        s.sxy -= d * s.sy;
+        s.sxx += -2.0 * d * s.sx + d * d * s.s0;
+        s.sx -= d * s.s0;
+        double fade = exp(-d / WEIGHT_TREND_DAYS);
+        s.s0 *= fade;
+        s.sx *= fade;
+        s.sy *= fade;
+        s.sxx *= fade;
+        s.sxy *= fade;
+        t.lastDay = day;
+    }
+    s.s0 += 1.0;   // the new point sits at x = 0
+    s.sy += kg;
+
+    if (t.entries > 0) t.smoothedKg += (1.0 - pow(1.0 - WEIGHT_SMOOTHING, max(gap, 1))) * (kg - t.smoothedKg);
+    t.latestKg = kg;
+    t.entries++;
+    updateSlope(s);
+}
+
+// --- Persistence ---
+// Series: one "YYYY-MM-DD|kg" line per weigh-in, append-only.
+// Stats:  entries|firstDate|lastDate|latest|smoothed|s0|sx|sy|sxx|sxy
+
+static void saveStats(const string& username, const WeightStats& s) {
+    const WeightTrend& t = s.trend;
+    ofstream out(weightStatsFileName(username), ios::trunc);
+    out << setprecision(17) << t.entries << "|" << dayNumberToDate(t.firstDay) << "|" << dayNumberToDate(t.lastDay)
+        << "|" << t.latestKg << "|" << t.smoothedKg << "|" << s.s0 << "|" << s.sx << "|" << s.sy
+        << "|" << s.sxx << "|" << s.sxy << "\n";
+}
+
+static bool loadStats(const string& username, WeightStats& s) {
+    ifstream file(weightStatsFileName(username));
+    string line;
+    if (!file || !getline(file, line)) return false;
+
+    vector<string> parts;
+    stringstream ss(trim(line));
+    string part;
+    while (getline(ss, part, '|')) parts.push_back(trim(part));
+    if (parts.size() < 10) return false;
+    try {
+        WeightTrend& t = s.trend;
+        t.entries = stoi(parts[0]);
+        t.firstDay = dateToDayNumber(parts[1]);
+        t.lastDay = dateToDayNumber(parts[2]);
+        t.latestKg = stod(parts[3]);
+        t.smoothedKg = stod(parts[4]);
+        s.s0 = stod(parts[5]);
+        s.sx = stod(parts[6]);
+        s.sy = stod(parts[7]);
+        s.sxx = stod(parts[8]);
+        s.sxy = stod(parts[9]);
+    } catch (...) {
+        return false;
+    }
+    updateSlope(s);
+    const WeightTrend& t = s.trend;
+    return t.entries > 0 && t.firstDay != NO_DAY && t.lastDay != NO_DAY && t.lastDay >= t.firstDay;
+}
+
+// Returns the cached statistics, loading them or (if the state file is
+// missing) replaying the series once.
+static WeightStats& statsFor(const string& username) {
+    auto it = weightStats.find(username);
+    if (it != weightStats.end()) return it->second;
+
+    WeightStats& s = weightStats[username];
+    if (loadStats(username, s)) return s;
+
+    s = WeightStats();
+    ifstream series(weightFileName(username));
+    string line;
+    while (getline(series, line)) {
+        size_t bar = line.find('|');
+        if (bar == string::npos) continue;
+        int day = dateToDayNumber(trim(line.substr(0, bar)));
+        double kg = 0.0;
+        try { kg = stod(trim(line.substr(bar + 1))); } catch (...) { continue; }
+        if (day != NO_DAY && kg > 0) addWeight(s, kg, day);
+    }
+    if (s.trend.entries > 0) saveStats(username, s);
+    return s;
+}
+
+// --- Public API ---
+
+bool recordWeight(const string& username, double kg, int day) {
+    // The statistics are reloaded under the lock, so weigh-ins another session
+    // recorded are kept
+    ensureUserDir(username);
+    FileLock lock(userLockFile(username), LOCK_MODE_EXCLUSIVE);
+    weightStats.erase(username);
+    WeightStats& s = statsFor(username);
+    {
+        ofstream series(weightFileName(username), ios::app);
+        if (!series) return false;
+        series << dayNumberToDate(day) << "|" << kg << "\n";
+        if (!series) return false;
+    }
+    addWeight(s, kg, day);
+    saveStats(username, s);
+    return true;
+}
+
+WeightTrend getWeightTrend(const string& username) {
+    return statsFor(username).trend;
+}
@@ -0,0 +1,39 @@
+#ifndef WEIGHT_H
+#define WEIGHT_H
+
+#include "models.h"
+#include "utils.h"
+#include <string>
+
+// Weight history per user.
+//
+// Every weigh-in is appended to the user's weight.txt ("YYYY-MM-DD|kg") and
+// never rewritten. Next to it, weight_stats.txt holds running
+// statistics that each weigh-in updates in O(1): an exponentially smoothed
+// weight and the sums of a least-squares line whose older points fade out
+// (time constant WEIGHT_TREND_DAYS). Showing the trend reads only that state.
+//
+// Nutrition targets follow the smoothed weight, not single weigh-ins, and are
+// recomputed only when it moves by WEIGHT_TARGET_STEP_KG or more.
+
+const double WEIGHT_SMOOTHING = 0.1;        // share of a new weigh-in in the smoothed weight (per day)
+const double WEIGHT_TREND_DAYS = 28.0;      // fade-out time constant of the trend line
+const double WEIGHT_TARGET_STEP_KG = 0.5;
+
+struct WeightTrend {
+    int entries = 0;
+    int firstDay = NO_DAY;
+    int lastDay = NO_DAY;
+    double latestKg = 0.0;
+    double smoothedKg = 0.0;
+    bool hasSlope = false;        // enough points over enough days for a line
+    double slopeKgPerWeek = 0.0;
+};
+
+// Appends a weigh-in for day (today in the UI) and updates the statistics.
+bool recordWeight(const std::string& username, double kg, int day);
+
+// Current statistics (rebuilt from the series once if the state file is missing).
+WeightTrend getWeightTrend(const std::string& username);
+
+#endif